@@ -0,0 +1,495 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "AmbisonicDecoder.h"
+#include "WeightedSum.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+using namespace fsh::fx;
+using fsh::util::SphericalVector;
+
+namespace
+{
+using Vector = std::array<double, 3>;
+using Triangle = std::array<size_t, 3>;
+
+// Number of virtual speakers for AllRAD, and of directions used to normalize the matrix:
+constexpr auto numVirtualSpeakers = 2000UL;
+constexpr auto numNormalizationDirections = 1000UL;
+
+// Imaginary speakers are added at the poles if no real speaker is within this many degrees:
+constexpr auto maxPoleDistance = 60.0;
+
+// Tolerance for points lying on a plane, and for directions lying on the edge of a triangle:
+constexpr auto epsilon = 1e-6;
+
+auto toRadians(double degrees) -> double
+{
+  return degrees * std::numbers::pi / 180.0;
+}
+
+// Any consistent cartesian coordinates will do, since these are only used for VBAP:
+auto toCartesian(const SphericalVector& direction) -> Vector
+{
+  const auto az = toRadians(direction.azimuth);
+  const auto el = toRadians(direction.elevation);
+  return { std::cos(el) * std::cos(az), std::cos(el) * std::sin(az), std::sin(el) };
+}
+
+auto dot(const Vector& a, const Vector& b) -> double
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+auto cross(const Vector& a, const Vector& b) -> Vector
+{
+  return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+}
+
+auto difference(const Vector& a, const Vector& b) -> Vector
+{
+  return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+}
+
+// Fibonacci lattice, which covers the sphere evenly (same as in HarmonicsTable):
+auto fibonacciSphere(size_t numDirections) -> std::vector<SphericalVector>
+{
+  const auto goldenAngle = 180.0 * (3.0 - std::sqrt(5.0));
+  auto directions = std::vector<SphericalVector>(numDirections);
+
+  for (auto i = 0UL; i < numDirections; ++i)
+  {
+    const auto z = 1.0 - 2.0 * (static_cast<double>(i) + 0.5) / static_cast<double>(numDirections);
+    directions[i] = {
+      .azimuth = std::fmod(static_cast<double>(i) * goldenAngle, 360.0) - 180.0,
+      .elevation = std::asin(z) * 180.0 / std::numbers::pi,
+    };
+  }
+
+  return directions;
+}
+
+template<int Order>
+using Weights = std::array<double, static_cast<size_t>(Order + 1)>;
+
+// Weight for each order, including the (2n + 1) factor of the sampling decoder for SN3D. For
+// max-rE, the weights are the Legendre polynomials evaluated at cos(137.9° / (N + 1.51)), which is
+// the approximation from Zotter & Frank, "All-Round Ambisonic Panning and Decoding" (2012):
+template<int Order>
+auto orderWeights(bool maxRE) -> Weights<Order>
+{
+  auto weights = Weights<Order>{};
+  weights.fill(1.0);
+
+  if (maxRE)
+  {
+    const auto x = std::cos(toRadians(137.9 / (Order + 1.51)));
+    auto previous = 1.0;
+    auto current = x;
+
+    for (auto n = 1; n <= Order; ++n)
+    {
+      weights[static_cast<size_t>(n)] = current;
+      const auto next = ((2 * n + 1) * x * current - n * previous) / (n + 1);
+      previous = current;
+      current = next;
+    }
+  }
+
+  for (auto n = 0; n <= Order; ++n)
+    weights[static_cast<size_t>(n)] *= 2 * n + 1;
+
+  return weights;
+}
+
+// One row of the sampling decoder, i.e. the gains that pick up the sound field in one direction:
+template<int Order>
+auto samplingRow(const SphericalVector& direction, const Weights<Order>& weights)
+  -> std::array<double, fsh::util::numChannelsForOrder(Order)>
+{
+  const auto coefficients = fsh::util::harmonics<Order>(direction);
+  auto row = std::array<double, fsh::util::numChannelsForOrder(Order)>{};
+
+  for (auto n = 0UL; n <= Order; ++n)
+    for (auto ch = n * n; ch < (n + 1) * (n + 1); ++ch)
+      row[ch] = weights[n] * static_cast<double>(coefficients[ch]);
+
+  return row;
+}
+
+// The faces of the convex hull of the given points, by brute force. This is slow (O(n^4)), but
+// the layouts are small, and it doesn't run on the audio thread. Faces whose plane passes through
+// the origin are skipped, since VBAP can't pan to them. Faces with more than three points, like
+// the sides of a cube, are covered by several overlapping triangles, which doesn't matter here:
+auto convexHull(const std::vector<Vector>& points) -> std::vector<Triangle>
+{
+  auto triangles = std::vector<Triangle>{};
+
+  for (auto a = 0UL; a < points.size(); ++a)
+    for (auto b = a + 1; b < points.size(); ++b)
+      for (auto c = b + 1; c < points.size(); ++c)
+      {
+        const auto normal =
+          cross(difference(points[b], points[a]), difference(points[c], points[a]));
+        const auto offset = dot(normal, points[a]);
+        if (std::abs(offset) < epsilon)
+          continue;
+
+        // All points need to be on the same side of the plane as the origin:
+        auto isFace = true;
+        for (const auto& point : points)
+          isFace = isFace && (dot(normal, point) - offset) * offset < epsilon;
+        if (isFace)
+          triangles.push_back({ a, b, c });
+      }
+
+  return triangles;
+}
+
+// VBAP gains for the given direction, using the triangle in which all gains are positive. If the
+// direction isn't covered by the hull, the triangle with the least negative gain is used, with the
+// negative gains set to zero. The gains are normalized to unit power:
+auto vbap(const Vector& direction,
+          const std::vector<Vector>& points,
+          const std::vector<Triangle>& triangles) -> std::pair<Triangle, Vector>
+{
+  auto best = std::pair<Triangle, Vector>{};
+  auto bestMinimum = -std::numeric_limits<double>::infinity();
+
+  for (const auto& triangle : triangles)
+  {
+    const auto& a = points[triangle[0]];
+    const auto& b = points[triangle[1]];
+    const auto& c = points[triangle[2]];
+
+    // Solve direction = g0 * a + g1 * b + g2 * c with Cramer's rule:
+    const auto determinant = dot(a, cross(b, c));
+    const auto gains = Vector{
+      dot(direction, cross(b, c)) / determinant,
+      dot(a, cross(direction, c)) / determinant,
+      dot(a, cross(b, direction)) / determinant,
+    };
+
+    const auto minimum = std::min({ gains[0], gains[1], gains[2] });
+    if (minimum > bestMinimum)
+    {
+      best = { triangle, gains };
+      bestMinimum = minimum;
+      if (minimum >= -epsilon)
+        break;
+    }
+  }
+
+  auto& gains = best.second;
+  for (auto& gain : gains)
+    gain = std::max(gain, 0.0);
+
+  const auto norm = std::sqrt(dot(gains, gains));
+  for (auto& gain : gains)
+    gain = norm > 0.0 ? gain / norm : 0.0;
+
+  return best;
+}
+
+template<int Order>
+using Rows = std::vector<std::array<double, fsh::util::numChannelsForOrder(Order)>>;
+
+template<int Order>
+auto samplingDecoder(const std::vector<SphericalVector>& speakers,
+                     const Weights<Order>& weights) -> Rows<Order>
+{
+  auto rows = Rows<Order>{};
+  for (const auto& speaker : speakers)
+    rows.push_back(samplingRow<Order>(speaker, weights));
+  return rows;
+}
+
+template<int Order>
+auto allradDecoder(const std::vector<SphericalVector>& speakers,
+                   const Weights<Order>& weights) -> Rows<Order>
+{
+  auto points = std::vector<Vector>{};
+  for (const auto& speaker : speakers)
+    points.push_back(toCartesian(speaker));
+
+  // Imaginary speakers close the gaps at the poles, so the hull surrounds the listener:
+  const auto byElevation = [](const auto& a, const auto& b) { return a.elevation < b.elevation; };
+  const auto [lowest, highest] = std::minmax_element(speakers.begin(), speakers.end(), byElevation);
+  if (90.0 - highest->elevation > maxPoleDistance)
+    points.push_back(toCartesian({ .azimuth = 0.0, .elevation = 90.0 }));
+  if (lowest->elevation + 90.0 > maxPoleDistance)
+    points.push_back(toCartesian({ .azimuth = 0.0, .elevation = -90.0 }));
+
+  const auto triangles = convexHull(points);
+  if (triangles.empty())
+  {
+    spdlog::warn("AmbisonicDecoder: layout doesn't surround the listener, using SAD instead");
+    return samplingDecoder<Order>(speakers, weights);
+  }
+
+  // Decode to the virtual speakers, and pan each one to its triangle. The rows of the imaginary
+  // speakers are discarded:
+  auto rows = Rows<Order>(points.size());
+  for (const auto& virtualSpeaker : fibonacciSphere(numVirtualSpeakers))
+  {
+    const auto row = samplingRow<Order>(virtualSpeaker, weights);
+    const auto [triangle, gains] = vbap(toCartesian(virtualSpeaker), points, triangles);
+
+    for (auto k = 0UL; k < 3; ++k)
+      for (auto ch = 0UL; ch < row.size(); ++ch)
+        rows[triangle[k]][ch] += gains[k] * row[ch];
+  }
+
+  rows.resize(speakers.size());
+  return rows;
+}
+
+// Scale the matrix so an encoded source has unit power, averaged across all directions:
+template<int Order>
+void normalize(Rows<Order>& rows)
+{
+  auto sumOfSquares = 0.0;
+  for (const auto& direction : fibonacciSphere(numNormalizationDirections))
+  {
+    const auto coefficients = fsh::util::harmonics<Order>(direction);
+    for (const auto& row : rows)
+    {
+      auto gain = 0.0;
+      for (auto ch = 0UL; ch < row.size(); ++ch)
+        gain += row[ch] * static_cast<double>(coefficients[ch]);
+      sumOfSquares += gain * gain;
+    }
+  }
+
+  const auto power = sumOfSquares / static_cast<double>(numNormalizationDirections);
+  if (!(power > 0.0))
+    return;
+
+  const auto scale = 1.0 / std::sqrt(power);
+  for (auto& row : rows)
+    for (auto& gain : row)
+      gain *= scale;
+}
+} // namespace
+
+template<int Order>
+AmbisonicDecoder<Order>::~AmbisonicDecoder()
+{
+  if (_worker.joinable())
+    _worker.join();
+}
+
+template<int Order>
+void AmbisonicDecoder<Order>::setLayout(const util::SpeakerLayout& layout, const Params& params)
+{
+  if (_worker.joinable())
+    _worker.join();
+  _worker = std::thread{ [this, layout, params] { compute(layout, params); } };
+}
+
+template<int Order>
+void AmbisonicDecoder<Order>::loadLayout(const std::filesystem::path& path, const Params& params)
+{
+  if (_worker.joinable())
+    _worker.join();
+  _worker = std::thread{ [this, path, params] { computeFromFile(path, params); } };
+}
+
+template<int Order>
+void AmbisonicDecoder<Order>::computeFromFile(const std::filesystem::path& path,
+                                              const Params& params)
+{
+  if (const auto layout = util::SpeakerLayout::fromFile(path))
+    compute(*layout, params);
+}
+
+template<int Order>
+void AmbisonicDecoder<Order>::compute(const util::SpeakerLayout& layout, const Params& params)
+{
+  auto speakers = layout.speakers;
+  if (speakers.empty())
+    return spdlog::error("AmbisonicDecoder: layout contains no speakers");
+
+  if (speakers.size() > static_cast<size_t>(maxNumSpeakers))
+  {
+    spdlog::warn("AmbisonicDecoder: layout has {} speakers, only the first {} are used",
+                 speakers.size(),
+                 maxNumSpeakers);
+    speakers.resize(maxNumSpeakers);
+  }
+
+  const auto weights = orderWeights<Order>(params.maxRE);
+  auto rows = params.method == DecodingMethod::SAD ? samplingDecoder<Order>(speakers, weights)
+                                                   : allradDecoder<Order>(speakers, weights);
+  normalize<Order>(rows);
+
+  auto& matrix = _slots[_back];
+  matrix.numSpeakers = rows.size();
+  for (auto speaker = 0UL; speaker < maxNumSpeakers; ++speaker)
+    for (auto ch = 0UL; ch < numChannels; ++ch)
+      matrix.gains[speaker][ch] =
+        speaker < rows.size() ? static_cast<float>(rows[speaker][ch]) : 0.0f;
+
+  // Publish the matrix, and take the slot that the audio thread is not using:
+  _back = _middle.exchange(_back | newMatrixFlag) & ~newMatrixFlag;
+}
+
+template<int Order>
+void AmbisonicDecoder<Order>::receive()
+{
+  if ((_middle.load() & newMatrixFlag) == 0)
+    return;
+
+  _front = _middle.exchange(_front) & ~newMatrixFlag;
+  _target = _slots[_front];
+  _changed = true;
+}
+
+template<int Order>
+auto AmbisonicDecoder<Order>::numSpeakers() const -> size_t
+{
+  return _target.numSpeakers;
+}
+
+template<int Order>
+void AmbisonicDecoder<Order>::reset()
+{
+  receive();
+  _current = _target;
+  _changed = false;
+}
+
+template<int Order>
+void AmbisonicDecoder<Order>::process(const juce::AudioBuffer<float>& ambi,
+                                      juce::AudioBuffer<float>& speakers)
+{
+  receive();
+
+  const auto numSamples = speakers.getNumSamples();
+  if (static_cast<size_t>(ambi.getNumChannels()) < numChannels || ambi.getNumSamples() < numSamples)
+  {
+    speakers.clear();
+    return spdlog::critical("AmbisonicDecoder: need {} channels and {} samples, got {} and {}",
+                            numChannels,
+                            numSamples,
+                            ambi.getNumChannels(),
+                            ambi.getNumSamples());
+  }
+
+  // While crossfading, the speakers of both matrices are needed (the unused rows are zero):
+  const auto numActive = std::min(std::max(_current.numSpeakers, _target.numSpeakers),
+                                  static_cast<size_t>(speakers.getNumChannels()));
+
+  // The crossfade from the current to the target matrix is done as a second matrix
+  // multiplication with their difference, scaled by the position in the block:
+  const auto ramp = _changed;
+  if (ramp)
+    for (auto speaker = 0UL; speaker < numActive; ++speaker)
+      for (auto ch = 0UL; ch < numChannels; ++ch)
+        _difference.gains[speaker][ch] = _target.gains[speaker][ch] - _current.gains[speaker][ch];
+
+  for (auto tile = 0UL; tile * speakersPerTile < numActive; ++tile)
+    processTile(tile, ambi, speakers, numActive, ramp);
+
+  for (auto ch = static_cast<int>(numActive); ch < speakers.getNumChannels(); ++ch)
+    speakers.clear(ch, 0, numSamples);
+
+  if (ramp)
+  {
+    _current = _target;
+    _changed = false;
+  }
+}
+
+template<int Order>
+void AmbisonicDecoder<Order>::processTile(size_t tile,
+                                          const juce::AudioBuffer<float>& ambi,
+                                          juce::AudioBuffer<float>& speakers,
+                                          size_t numSpeakers,
+                                          bool ramp)
+{
+  const auto firstSpeaker = tile * speakersPerTile;
+  const auto numSamples = speakers.getNumSamples();
+
+  // One tile of the output (speakersPerTile x samplesPerTile) is accumulated over all channels,
+  // while it stays in the cache. maxNumSpeakers is a multiple of speakersPerTile, so the last tile
+  // can always read speakersPerTile rows:
+  static_assert(maxNumSpeakers % speakersPerTile == 0);
+  auto tileOutput = std::array<std::array<float, samplesPerTile>, speakersPerTile>{};
+  auto tileRamp = std::array<std::array<float, samplesPerTile>, speakersPerTile>{};
+  auto rampPosition = std::array<float, samplesPerTile>{};
+  auto samples = std::array<const float*, numChannels>{};
+
+  for (auto start = 0; start < numSamples; start += samplesPerTile)
+  {
+    const auto length = static_cast<size_t>(std::min(samplesPerTile, numSamples - start));
+
+    for (auto& row : tileOutput)
+      std::fill_n(row.begin(), length, 0.0f);
+    if (ramp)
+      for (auto& row : tileRamp)
+        std::fill_n(row.begin(), length, 0.0f);
+
+    for (auto ch = 0UL; ch < numChannels; ++ch)
+      samples[ch] = ambi.getReadPointer(static_cast<int>(ch), start);
+
+    for (auto s = 0UL; s < speakersPerTile; ++s)
+    {
+      const auto speaker = firstSpeaker + s;
+      util::addWeightedSum(
+        tileOutput[s].data(), _current.gains[speaker].data(), samples.data(), numChannels, length);
+      if (ramp)
+        util::addWeightedSum(tileRamp[s].data(),
+                             _difference.gains[speaker].data(),
+                             samples.data(),
+                             numChannels,
+                             length);
+    }
+
+    if (ramp)
+      for (auto i = 0UL; i < length; ++i)
+        rampPosition[i] = static_cast<float>(static_cast<size_t>(start) + i + 1) /
+                          static_cast<float>(numSamples);
+
+    for (auto s = 0UL; s < speakersPerTile && firstSpeaker + s < numSpeakers; ++s)
+    {
+      auto* const out = speakers.getWritePointer(static_cast<int>(firstSpeaker + s), start);
+
+      if (ramp)
+        for (auto i = 0UL; i < length; ++i)
+          out[i] = tileOutput[s][i] + rampPosition[i] * tileRamp[s][i];
+      else
+        std::copy_n(tileOutput[s].cbegin(), length, out);
+    }
+  }
+}
+
+static_assert(fsh::util::maxAmbiOrder == 5, "update the explicit instantiations below");
+template class fsh::fx::AmbisonicDecoder<1>;
+template class fsh::fx::AmbisonicDecoder<2>;
+template class fsh::fx::AmbisonicDecoder<3>;
+template class fsh::fx::AmbisonicDecoder<4>;
+template class fsh::fx::AmbisonicDecoder<5>;
@@ -0,0 +1,155 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "SpeakerLayout.h"
+#include "SphericalHarmonics.h"
+#include <atomic>
+#include <filesystem>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <thread>
+
+namespace fsh::fx
+{
+/// Method used to compute the decoding matrix of AmbisonicDecoder.
+enum class DecodingMethod
+{
+  AllRAD, ///< decode to virtual speakers, then pan to real speakers (for any layout)
+  SAD,    ///< sample the sound field at each speaker (for uniform layouts)
+};
+
+/// Decoder parameters. These are the same for all AmbisonicDecoder instantiations.
+struct DecoderParams
+{
+  DecodingMethod method = DecodingMethod::AllRAD; ///< method used to compute the matrix
+  bool maxRE = true;                              ///< weight the orders for max-rE
+};
+
+/**
+Decodes Ambisonics to a loudspeaker layout.
+
+The decoding matrix (speakers x channels) is computed from a util::SpeakerLayout, using one of two
+methods:
+
+- **AllRAD** (All-Round Ambisonic Decoding, Zotter & Frank 2012): the sound field is first decoded
+  to a dense, uniform grid of virtual speakers, which are then panned to the real speakers with
+  VBAP. This works well for irregular layouts, including ones that only cover part of the sphere.
+  Gaps at the top and bottom of the layout are closed with imaginary speakers, whose signals are
+  discarded.
+- **SAD** (Sampling Ambisonic Decoding): each speaker picks up the sound field in its own
+  direction. This is only a good choice for layouts that are (close to) uniform, e.g. a cube.
+
+Optionally, the orders are weighted to maximize the energy vector (max-rE), which reduces the
+side lobes of the decoded sources. In both cases, the matrix is scaled so a source has unit power
+on average across all directions.
+
+The matrix is computed on a background thread, since AllRAD takes a few milliseconds for larger
+layouts. The new matrix is passed to the audio thread through a lock-free triple buffer, and the
+output is crossfaded from the old to the new matrix over the next block. Until the first matrix
+is ready, the output is silent.
+
+The decoding itself is a matrix multiplication of the matrix with the input block (channels x
+samples), done in tiles of speakers and samples that stay in the cache while all channels are
+accumulated into them.
+
+**Before using:** set a layout with setLayout() or loadLayout(), from a thread other than the
+audio thread.
+
+**To use:** call process() once per block.
+*/
+template<int Order = util::maxAmbiOrder>
+class AmbisonicDecoder
+{
+public:
+  /// Number of input channels.
+  static constexpr auto numChannels = util::numChannelsForOrder(Order);
+
+  /// Maximum number of speakers, i.e. output channels.
+  static constexpr auto maxNumSpeakers = 64;
+
+  /// Decoder parameters
+  using Params = DecoderParams;
+
+  AmbisonicDecoder() = default;
+  ~AmbisonicDecoder();
+  AmbisonicDecoder(const AmbisonicDecoder&) = delete;
+  AmbisonicDecoder(AmbisonicDecoder&&) = delete;
+  auto operator=(const AmbisonicDecoder&) -> AmbisonicDecoder& = delete;
+  auto operator=(AmbisonicDecoder&&) -> AmbisonicDecoder& = delete;
+
+  /// Start computing the matrix for the given layout in the background. Must not be called from
+  /// the audio thread, since it waits for any previous computation to finish. Speakers beyond
+  /// maxNumSpeakers are ignored.
+  void setLayout(const util::SpeakerLayout&, const Params& = {});
+
+  /// Same as setLayout(), but the layout file is also read and parsed in the background. If the
+  /// file can't be read, the error is logged and the current matrix is kept.
+  void loadLayout(const std::filesystem::path&, const Params& = {});
+
+  /// Number of speakers in the matrix that is currently used by process().
+  auto numSpeakers() const -> size_t;
+
+  /// Decode one block. The first numSpeakers() channels of `speakers` are overwritten with the
+  /// speaker signals, and any remaining channels are cleared. `ambi` and `speakers` must not be
+  /// the same buffer.
+  void process(const juce::AudioBuffer<float>& ambi, juce::AudioBuffer<float>& speakers);
+
+  /// Jump to the most recent matrix, without crossfading.
+  void reset();
+
+private:
+  // Speakers per tile of the matrix multiplication, and samples per tile:
+  static constexpr auto speakersPerTile = 4UL;
+  static constexpr auto samplesPerTile = 64;
+
+  struct Matrix
+  {
+    size_t numSpeakers = 0;
+    std::array<std::array<float, numChannels>, maxNumSpeakers> gains = {};
+  };
+
+  // The index of the slot shared between the threads, with a flag that is set when the background
+  // thread has written a new matrix to it:
+  static constexpr auto newMatrixFlag = 4U;
+
+  void compute(const util::SpeakerLayout&, const Params&);
+  void computeFromFile(const std::filesystem::path&, const Params&);
+  void receive();
+  void processTile(size_t tile,
+                   const juce::AudioBuffer<float>& ambi,
+                   juce::AudioBuffer<float>& speakers,
+                   size_t numSpeakers,
+                   bool ramp);
+
+  // Triple buffer: the audio thread reads from slot _front, the background thread writes to slot
+  // _back, and the two are swapped with the slot in _middle:
+  std::array<Matrix, 3> _slots = {};
+  std::atomic<unsigned> _middle = 1;
+  unsigned _front = 0;
+  unsigned _back = 2;
+  std::thread _worker;
+
+  Matrix _current = {};
+  Matrix _target = {};
+  Matrix _difference = {};
+  bool _changed = false;
+};
+} // namespace fsh::fx
@@ -22,31 +22,222 @@
 #include "AmbisonicEncoder.h"
 #include "SphericalHarmonics.h"
 #include <spdlog/spdlog.h>
+#include <utility>
 
 using namespace fsh::fx;
 
-auto AmbisonicEncoder::getCoefficientsForNextSample()
-  -> std::array<float, fsh::util::maxNumChannels>
+namespace
 {
-  auto result = std::array<float, fsh::util::maxNumChannels>{};
+// Target coefficients for the given order. The closed-form polynomials are faster for the higher
+// orders, the recurrence is faster for the lower orders (see fsh::util::harmonics<Order>()):
+template<int Order>
+auto targetHarmonics(const fsh::util::SphericalVector& direction)
+{
+  if constexpr (Order <= 3)
+    return fsh::util::harmonics<Order>(direction);
+  else
+  {
+    const auto allCoefficients = fsh::util::harmonics(direction);
+    auto coefficients = std::array<float, fsh::util::numChannelsForOrder(Order)>{};
+    std::copy_n(allCoefficients.cbegin(), coefficients.size(), coefficients.begin());
+    return coefficients;
+  }
+}
+} // namespace
+
+template<int Order>
+auto AmbisonicEncoder<Order>::getCoefficientsForNextSample() -> std::array<float, numChannels>
+{
+  if (_params.smoothing == Smoothing::Linear)
+  {
+    if (_rampSamplesLeft > 0 && --_rampSamplesLeft == 0)
+      _gains = _targetGains;
+    else if (_rampSamplesLeft > 0)
+      for (auto i = 0U; i < _gains.size(); ++i)
+        _gains[i] += _gainIncrements[i];
+    return _gains;
+  }
+
+  auto result = std::array<float, numChannels>{};
   for (auto i = 0U; i < _coefficients.size(); ++i)
     result[i] = static_cast<float>(_coefficients[i].getNextValue());
   return result;
 }
 
-void AmbisonicEncoder::setSampleRate(double sampleRate)
+template<int Order>
+void AmbisonicEncoder<Order>::encodeBlock(const float* mono,
+                                          juce::AudioBuffer<float>& out,
+                                          int numSamples,
+                                          bool accumulate,
+                                          int outputOffset)
+{
+  const auto numChannelsAvailable = static_cast<size_t>(out.getNumChannels());
+  const auto numChannelsToProcess = juce::jmin(_coefficients.size(), numChannelsAvailable);
+
+  if (numChannelsAvailable < _coefficients.size())
+    spdlog::warn("encoder provided {} ambisonics coefficients, "
+                 "but only {} channels are available",
+                 _coefficients.size(),
+                 numChannelsAvailable);
+
+  if (outputOffset + numSamples > out.getNumSamples())
+    return spdlog::critical("outputOffset ({}) + numSamples ({}) > bufferSize ({})",
+                            outputOffset,
+                            numSamples,
+                            out.getNumSamples());
+
+  if (_params.smoothing == Smoothing::Linear)
+    return encodeBlockLinear(mono, out, numSamples, accumulate, outputOffset, numChannelsToProcess);
+
+  // The gain ramp is computed for a short chunk of samples at a time, so the multiply(-add) can be
+  // done for the whole chunk in one vectorized call without allocating a gain buffer:
+  constexpr auto chunkSize = 64;
+  auto gains = std::array<float, chunkSize>{};
+
+  for (auto ch = 0U; ch < numChannelsToProcess; ++ch)
+  {
+    auto* const output = out.getWritePointer(static_cast<int>(ch), outputOffset);
+
+    for (auto start = 0; start < numSamples; start += chunkSize)
+    {
+      const auto length = juce::jmin(chunkSize, numSamples - start);
+
+      for (auto i = 0; i < length; ++i)
+        gains[static_cast<size_t>(i)] = static_cast<float>(_coefficients[ch].getNextValue());
+
+      if (accumulate)
+        juce::FloatVectorOperations::addWithMultiply(
+          output + start, mono + start, gains.data(), length);
+      else
+        juce::FloatVectorOperations::multiply(output + start, mono + start, gains.data(), length);
+    }
+  }
+}
+
+template<int Order>
+void AmbisonicEncoder<Order>::encodeBlockLinear(const float* mono,
+                                                juce::AudioBuffer<float>& out,
+                                                int numSamples,
+                                                bool accumulate,
+                                                int outputOffset,
+                                                size_t numChannelsToProcess)
+{
+  // The block is split into the rest of the current ramp (if any), and a constant-gain part:
+  const auto rampSamples = juce::jmin(numSamples, _rampSamplesLeft);
+  const auto rampFinished = rampSamples == _rampSamplesLeft;
+
+  constexpr auto chunkSize = 64;
+  auto gains = std::array<float, chunkSize>{};
+
+  for (auto ch = 0U; ch < numChannelsToProcess; ++ch)
+  {
+    auto* const output = out.getWritePointer(static_cast<int>(ch), outputOffset);
+
+    for (auto start = 0; start < rampSamples; start += chunkSize)
+    {
+      const auto length = juce::jmin(chunkSize, rampSamples - start);
+
+      for (auto i = 0; i < length; ++i)
+        gains[static_cast<size_t>(i)] =
+          _gains[ch] + _gainIncrements[ch] * static_cast<float>(start + i + 1);
+
+      if (accumulate)
+        juce::FloatVectorOperations::addWithMultiply(
+          output + start, mono + start, gains.data(), length);
+      else
+        juce::FloatVectorOperations::multiply(output + start, mono + start, gains.data(), length);
+    }
+
+    if (!rampFinished)
+      continue;
+
+    const auto gain = _targetGains[ch];
+    const auto constantSamples = numSamples - rampSamples;
+    auto* const constantOutput = output + rampSamples;
+    const auto* const constantInput = mono + rampSamples;
+
+    if (constantSamples == 0 || (accumulate && juce::exactlyEqual(gain, 0.0f)))
+      continue;
+
+    if (accumulate)
+      juce::FloatVectorOperations::addWithMultiply(
+        constantOutput, constantInput, gain, constantSamples);
+    else if (juce::exactlyEqual(gain, 0.0f))
+      juce::FloatVectorOperations::clear(constantOutput, constantSamples);
+    else
+      juce::FloatVectorOperations::copyWithMultiply(
+        constantOutput, constantInput, gain, constantSamples);
+  }
+
+  // Advance the ramps of all channels, including any that had no output channel to write to:
+  if (rampFinished)
+    _gains = _targetGains;
+  else
+    for (auto ch = 0U; ch < _gains.size(); ++ch)
+      _gains[ch] += _gainIncrements[ch] * static_cast<float>(rampSamples);
+
+  _rampSamplesLeft -= rampSamples;
+}
+
+template<int Order>
+void AmbisonicEncoder<Order>::setSampleRate(double sampleRate)
 {
   for (auto& follower : _coefficients)
     follower.setSampleRate(sampleRate);
 }
 
-void AmbisonicEncoder::setParams(const Params& params)
+template<int Order>
+void AmbisonicEncoder<Order>::setHarmonicsTable(std::shared_ptr<const util::HarmonicsTable> table)
+{
+  _harmonicsTable = std::move(table);
+}
+
+template<int Order>
+void AmbisonicEncoder<Order>::setParams(const Params& params)
 {
+  // Continue from the current coefficients when the smoothing mode changes:
+  if (params.smoothing != _params.smoothing)
+  {
+    if (params.smoothing == Smoothing::Linear)
+    {
+      for (auto i = 0U; i < _coefficients.size(); ++i)
+        _gains[i] = static_cast<float>(_coefficients[i].getCurrentValue());
+      _targetGains = _gains;
+      _rampSamplesLeft = 0;
+    }
+    else
+      for (auto i = 0U; i < _coefficients.size(); ++i)
+        _coefficients[i].reset(_gains[i]);
+  }
+
   _params = params;
   updateCoefficients();
 }
 
-void AmbisonicEncoder::updateCoefficients()
+template<int Order>
+void AmbisonicEncoder<Order>::startRamp(const std::array<float, numChannels>& targets)
+{
+  // Static sources keep calling setParams() with the same direction, which must not restart the
+  // ramp (or leave the constant-gain state):
+  if (targets == _targetGains)
+    return;
+
+  _targetGains = targets;
+
+  if (_params.rampLength <= 0)
+  {
+    _gains = targets;
+    _rampSamplesLeft = 0;
+    return;
+  }
+
+  for (auto i = 0U; i < _gains.size(); ++i)
+    _gainIncrements[i] = (targets[i] - _gains[i]) / static_cast<float>(_params.rampLength);
+  _rampSamplesLeft = _params.rampLength;
+}
+
+template<int Order>
+void AmbisonicEncoder<Order>::updateCoefficients()
 {
   const auto wholeOrder = static_cast<size_t>(_params.order.get());
   const auto fadeGain = _params.order.get() - static_cast<float>(wholeOrder);
@@ -54,19 +245,34 @@ void AmbisonicEncoder::updateCoefficients()
   const auto fullGainChannels = (wholeOrder + 1) * (wholeOrder + 1);
   const auto reducedGainChannels = (wholeOrder + 2) * (wholeOrder + 2);
 
-  const auto targetCoefficients = harmonics(_params.direction);
+  auto targetCoefficients = std::array<float, numChannels>{};
+  if (_harmonicsTable)
+    _harmonicsTable->lookup(_params.direction, targetCoefficients);
+  else
+    targetCoefficients = targetHarmonics<Order>(_params.direction);
 
   static_assert(std::tuple_size_v<decltype(targetCoefficients)> ==
                   std::tuple_size_v<decltype(_coefficients)>,
                 "targetCoefficients and _coefficients must have the same size");
 
-  for (auto i = 0U; i < _coefficients.size(); ++i)
+  for (auto i = 0U; i < targetCoefficients.size(); ++i)
   {
-    if (i < fullGainChannels)
-      _coefficients[i].setTargetValue(targetCoefficients[i]);
-    else if (i < reducedGainChannels)
-      _coefficients[i].setTargetValue(fadeGain * targetCoefficients[i]);
-    else
-      _coefficients[i].setTargetValue(0.0f);
+    if (i >= reducedGainChannels)
+      targetCoefficients[i] = 0.0f;
+    else if (i >= fullGainChannels)
+      targetCoefficients[i] *= fadeGain;
   }
+
+  if (_params.smoothing == Smoothing::Linear)
+    return startRamp(targetCoefficients);
+
+  for (auto i = 0U; i < _coefficients.size(); ++i)
+    _coefficients[i].setTargetValue(targetCoefficients[i]);
 }
+
+static_assert(fsh::util::maxAmbiOrder == 5, "update the explicit instantiations below");
+template class fsh::fx::AmbisonicEncoder<1>;
+template class fsh::fx::AmbisonicEncoder<2>;
+template class fsh::fx::AmbisonicEncoder<3>;
+template class fsh::fx::AmbisonicEncoder<4>;
+template class fsh::fx::AmbisonicEncoder<5>;
@@ -22,38 +22,85 @@
 #pragma once
 #include "BoundedValue.h"
 #include "EnvelopeFollower.h"
+#include "HarmonicsTable.h"
 #include "SphericalHarmonics.h"
 #include "SphericalVector.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <memory>
 
 namespace fsh::fx
 {
 /**
 Provides coefficients to encode a mono signal into Ambisonics.
 
-The output will always have 36 channels, representing fifth order Ambisonic coefficients.
-However, setting the order parameter lower will result in the higher order channels being zeroed.
-Fractional orders are supported, allowing smooth fading between orders. In general, for an order
-setting of `n`, the first `ceil(n + 1) ^ 2` channels will be non-zero.
+The encoder is instantiated for a fixed maximum order, which defaults to fifth order. The output
+will always have `(Order + 1) ^ 2` channels (36 channels for fifth order), and all loops over the
+channels have a compile-time length. Pick the instantiation that matches the output bus, so no work
+is wasted on channels that are always zero.
+
+Setting the order parameter lower than `Order` will result in the higher order channels being
+zeroed. Fractional orders are supported, allowing smooth fading between orders. In general, for an
+order setting of `n`, the first `ceil(n + 1) ^ 2` channels will be non-zero.
+
+With exponential smoothing (the default), the coefficients approach their targets a little further
+on every sample, and never quite stop moving. With linear smoothing, each change of direction or
+order starts a ramp from the current to the new coefficients, which lasts for `rampLength`
+samples. Once the ramp is finished, the coefficients are constant until the next change, and
+encodeBlock() only does one vectorized multiply(-add) per channel. This makes static sources very
+cheap. When switching between the two modes, the new mode continues from the current coefficients.
 
 To use, you must first set the sampling rate using setSampleRate(). You can then set direction
-and order via the setParams() method. Finally, call getCoefficientsForNextSample() in a loop for
-each input sample. Multiply the input sample by each element to get the values for the output
-channels.
+and order via the setParams() method. Finally, call encodeBlock() once per block to write the
+encoded signal into an ambisonic buffer. Alternatively, call getCoefficientsForNextSample() in a
+loop for each input sample, and multiply the input sample by each element to get the values for
+the output channels.
+
+By default, the coefficients are computed from scratch whenever the parameters change. If the
+parameters change very often, e.g. with fast automation or many voices, you can share a
+util::HarmonicsTable via setHarmonicsTable() instead, which replaces the trigonometric functions
+and polynomials with an interpolated table lookup.
 
 > This class is a refactoring of code from the [IEM Plugin Suite](https://plugins.iem.at/).
 */
+template<int Order = util::maxAmbiOrder>
 class AmbisonicEncoder
 {
 public:
+  /// Maximum order, i.e. the order of the output channels.
+  static constexpr auto maxOrder = Order;
+
+  /// Number of output channels.
+  static constexpr auto numChannels = util::numChannelsForOrder(Order);
+
+  /// How changes to the coefficients are smoothed.
+  enum class Smoothing
+  {
+    Exponential, ///< exponential approach, using one util::EnvelopeFollower per channel
+    Linear,      ///< linear ramp over `Params::rampLength` samples, then constant gains
+  };
+
   /// Parameters for AmbisonicEncoder.
   struct Params
   {
-    util::SphericalVector direction; ///< direction to encode to
-    util::BoundedFloat<0, util::maxAmbiOrder> order = util::maxAmbiOrder; ///< order to encode to
+    util::SphericalVector direction;              ///< direction to encode to
+    util::BoundedFloat<0, Order> order = Order;   ///< order to encode to
+    Smoothing smoothing = Smoothing::Exponential; ///< coefficient smoothing mode
+    int rampLength = 256;                         ///< ramp length in samples (linear smoothing)
   };
 
   /// Get the channel coefficients for the next input sample.
-  auto getCoefficientsForNextSample() -> std::array<float, util::maxNumChannels>;
+  auto getCoefficientsForNextSample() -> std::array<float, numChannels>;
+
+  /// Encode a block of mono samples into the ambisonic buffer `out`. The coefficient smoothing is
+  /// advanced by `numSamples` samples, exactly as if getCoefficientsForNextSample() had been called
+  /// once per sample. If `accumulate` is true, the encoded signal is added to the existing contents
+  /// of `out`, otherwise it replaces them. The encoded signal is written starting at sample index
+  /// `outputOffset` of `out`.
+  void encodeBlock(const float* mono,
+                   juce::AudioBuffer<float>& out,
+                   int numSamples,
+                   bool accumulate,
+                   int outputOffset = 0);
 
   /// Set order and direction for encoding.
   void setParams(const Params&);
@@ -61,10 +108,29 @@ public:
   /// Set the sample rate. This must be set before using the AmbisonicEncoder.
   void setSampleRate(double sampleRate);
 
+  /// Look up the coefficients in the given table instead of computing them. Pass `nullptr` to go
+  /// back to computing them. The change takes effect on the next call to setParams().
+  void setHarmonicsTable(std::shared_ptr<const util::HarmonicsTable>);
+
 private:
   void updateCoefficients();
+  void startRamp(const std::array<float, numChannels>& targets);
+  void encodeBlockLinear(const float* mono,
+                         juce::AudioBuffer<float>& out,
+                         int numSamples,
+                         bool accumulate,
+                         int outputOffset,
+                         size_t numChannelsToProcess);
 
   Params _params;
-  std::array<util::EnvelopeFollower, util::maxNumChannels> _coefficients;
+  std::array<util::EnvelopeFollower, numChannels> _coefficients;
+
+  // Linear smoothing state:
+  std::array<float, numChannels> _gains = {};
+  std::array<float, numChannels> _targetGains = {};
+  std::array<float, numChannels> _gainIncrements = {};
+  int _rampSamplesLeft = 0;
+
+  std::shared_ptr<const util::HarmonicsTable> _harmonicsTable;
 };
 } // namespace fsh::fx
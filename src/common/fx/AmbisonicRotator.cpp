@@ -0,0 +1,297 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "AmbisonicRotator.h"
+#include <cmath>
+#include <numbers>
+#include <spdlog/spdlog.h>
+#include <utility>
+
+using namespace fsh::fx;
+
+namespace
+{
+using Matrix3 = std::array<std::array<double, 3>, 3>;
+
+auto multiply(const Matrix3& a, const Matrix3& b) -> Matrix3
+{
+  auto result = Matrix3{};
+  for (auto i = 0U; i < 3; ++i)
+    for (auto j = 0U; j < 3; ++j)
+      for (auto k = 0U; k < 3; ++k)
+        result[i][j] += a[i][k] * b[k][j];
+  return result;
+}
+
+// Rotation matrix in the cartesian coordinates that the spherical harmonics are defined in, i.e.
+// x to the front, y to the left, z up. Azimuth is anticlockwise in these coordinates, so all three
+// angles are negated to get the conventions described in the class documentation:
+auto cartesianRotation(double yaw, double pitch, double roll) -> Matrix3
+{
+  const auto toRadians = [](double degrees) { return -degrees * std::numbers::pi / 180.0; };
+  const auto [sinYaw, cosYaw] = std::pair{ std::sin(toRadians(yaw)), std::cos(toRadians(yaw)) };
+  const auto [sinPitch, cosPitch] =
+    std::pair{ std::sin(toRadians(pitch)), std::cos(toRadians(pitch)) };
+  const auto [sinRoll, cosRoll] = std::pair{ std::sin(toRadians(roll)), std::cos(toRadians(roll)) };
+
+  const auto rotateZ =
+    Matrix3{ { { cosYaw, -sinYaw, 0.0 }, { sinYaw, cosYaw, 0.0 }, { 0.0, 0.0, 1.0 } } };
+  const auto rotateY =
+    Matrix3{ { { cosPitch, 0.0, sinPitch }, { 0.0, 1.0, 0.0 }, { -sinPitch, 0.0, cosPitch } } };
+  const auto rotateX =
+    Matrix3{ { { 1.0, 0.0, 0.0 }, { 0.0, cosRoll, -sinRoll }, { 0.0, sinRoll, cosRoll } } };
+
+  return multiply(rotateZ, multiply(rotateY, rotateX));
+}
+
+/*
+One block of the rotation matrix, for a single order `l`, indexed from -l to +l in both directions
+like the degree `m` of the harmonics. Channel `m` of order `l` is at index `l * l + l + m` (ACN).
+*/
+template<int Order>
+class Block
+{
+public:
+  explicit Block(int order)
+    : _order(order)
+  {
+  }
+
+  auto operator()(int m, int n) const -> double { return _values[index(m)][index(n)]; }
+  auto operator()(int m, int n) -> double& { return _values[index(m)][index(n)]; }
+  auto order() const -> int { return _order; }
+
+private:
+  auto index(int m) const -> size_t { return static_cast<size_t>(m + _order); }
+
+  static constexpr auto size = static_cast<size_t>(2 * Order + 1);
+  int _order;
+  std::array<std::array<double, size>, size> _values = {};
+};
+
+// The helper function P from Ivanic & Ruedenberg, Table 2 (including the 1998 errata):
+template<int Order>
+auto p(int i, int a, int b, const Block<Order>& first, const Block<Order>& previous) -> double
+{
+  const auto l = previous.order() + 1;
+  if (b == l)
+    return first(i, 1) * previous(a, l - 1) - first(i, -1) * previous(a, -l + 1);
+  if (b == -l)
+    return first(i, 1) * previous(a, -l + 1) + first(i, -1) * previous(a, l - 1);
+  return first(i, 0) * previous(a, b);
+}
+
+// One element of the block for order `l`, from the block for order `l - 1` (Table 1 and 2):
+template<int Order>
+auto element(int m, int n, const Block<Order>& first, const Block<Order>& previous) -> double
+{
+  const auto l = previous.order() + 1;
+  const auto d = (m == 0) ? 1.0 : 0.0;
+  const auto absM = std::abs(m);
+  const auto denominator = (std::abs(n) == l) ? (2.0 * l) * (2.0 * l - 1.0) : (l + n) * (l - n);
+
+  const auto u = std::sqrt((l + m) * (l - m) / denominator);
+  const auto v =
+    0.5 * std::sqrt((1.0 + d) * (l + absM - 1) * (l + absM) / denominator) * (1 - 2 * d);
+  const auto w = -0.5 * std::sqrt((l - absM - 1) * (l - absM) / denominator) * (1 - d);
+
+  // Where u or w are zero, P would be evaluated outside of the previous block, so it is skipped:
+  auto result = 0.0;
+
+  if (absM < l)
+    result += u * p(0, m, n, first, previous);
+
+  if (m == 0)
+    result += v * (p(1, 1, n, first, previous) + p(-1, -1, n, first, previous));
+  else if (m > 0)
+    result += v * (p(1, m - 1, n, first, previous) * std::sqrt(m == 1 ? 2.0 : 1.0) -
+                   p(-1, -m + 1, n, first, previous) * (m == 1 ? 0.0 : 1.0));
+  else
+    result += v * (p(1, m + 1, n, first, previous) * (m == -1 ? 0.0 : 1.0) +
+                   p(-1, -m - 1, n, first, previous) * std::sqrt(m == -1 ? 2.0 : 1.0));
+
+  if (m != 0 && absM < l - 1)
+  {
+    if (m > 0)
+      result += w * (p(1, m + 1, n, first, previous) + p(-1, -m - 1, n, first, previous));
+    else
+      result += w * (p(1, m - 1, n, first, previous) - p(-1, -m + 1, n, first, previous));
+  }
+
+  return result;
+}
+
+// The full block-diagonal rotation matrix, up to the given order:
+template<int Order, typename Matrix>
+void computeRotation(double yaw, double pitch, double roll, Matrix& matrix)
+{
+  for (auto& row : matrix)
+    row.fill(0.0f);
+
+  // Order 0 is omnidirectional, and doesn't change under rotation:
+  matrix[0][0] = 1.0f;
+
+  // The first order channels are Y, Z, X (ACN), i.e. m = -1, 0, 1 correspond to y, z, x:
+  const auto rotation = cartesianRotation(yaw, pitch, roll);
+  constexpr auto axis = std::array<size_t, 3>{ 1, 2, 0 };
+
+  auto first = Block<Order>{ 1 };
+  for (auto m = -1; m <= 1; ++m)
+    for (auto n = -1; n <= 1; ++n)
+      first(m, n) = rotation[axis[static_cast<size_t>(m + 1)]][axis[static_cast<size_t>(n + 1)]];
+
+  auto previous = first;
+  for (auto l = 1; l <= Order; ++l)
+  {
+    auto current = Block<Order>{ l };
+
+    for (auto m = -l; m <= l; ++m)
+      for (auto n = -l; n <= l; ++n)
+        current(m, n) = (l == 1) ? first(m, n) : element(m, n, first, previous);
+
+    const auto offset = l * l + l;
+    for (auto m = -l; m <= l; ++m)
+      for (auto n = -l; n <= l; ++n)
+        matrix[static_cast<size_t>(offset + m)][static_cast<size_t>(offset + n)] =
+          static_cast<float>(current(m, n));
+
+    previous = current;
+  }
+}
+} // namespace
+
+template<int Order>
+AmbisonicRotator<Order>::AmbisonicRotator()
+{
+  computeRotation<Order>(0.0, 0.0, 0.0, _target);
+  reset();
+}
+
+template<int Order>
+void AmbisonicRotator<Order>::setParams(const Params& params)
+{
+  if (juce::exactlyEqual(params.yaw, _params.yaw) &&
+      juce::exactlyEqual(params.pitch, _params.pitch) &&
+      juce::exactlyEqual(params.roll, _params.roll))
+    return;
+
+  _params = params;
+  computeRotation<Order>(_params.yaw, _params.pitch, _params.roll, _target);
+  _changed = true;
+}
+
+template<int Order>
+void AmbisonicRotator<Order>::reset()
+{
+  _current = _target;
+  _changed = false;
+}
+
+template<int Order>
+void AmbisonicRotator<Order>::process(juce::AudioBuffer<float>& audio)
+{
+  if (static_cast<size_t>(audio.getNumChannels()) < numChannels)
+    return spdlog::error("AmbisonicRotator: need {} channels, got {}",
+                         numChannels,
+                         audio.getNumChannels());
+
+  const auto crossfade = _changed;
+  if (crossfade)
+    for (auto row = 0U; row < numChannels; ++row)
+      for (auto col = 0U; col < numChannels; ++col)
+        _difference[row][col] = _target[row][col] - _current[row][col];
+
+  // Order 0 is never changed by a rotation:
+  for (auto order = 1; order <= Order; ++order)
+    processOrder(order, audio, crossfade);
+
+  if (crossfade)
+    reset();
+}
+
+template<int Order>
+void AmbisonicRotator<Order>::processOrder(int order,
+                                           juce::AudioBuffer<float>& audio,
+                                           bool crossfade)
+{
+  constexpr auto chunkSize = 64;
+  constexpr auto maxBlockSize = static_cast<size_t>(2 * Order + 1);
+
+  const auto firstChannel = static_cast<size_t>(order * order);
+  const auto blockSize = static_cast<size_t>(2 * order + 1);
+  const auto numSamples = audio.getNumSamples();
+
+  // The rotation is done in place, so each chunk of the input channels is copied first:
+  auto input = std::array<std::array<float, chunkSize>, maxBlockSize>{};
+  auto fade = std::array<float, chunkSize>{};
+  auto faded = std::array<float, chunkSize>{};
+
+  for (auto start = 0; start < numSamples; start += chunkSize)
+  {
+    const auto length = static_cast<size_t>(std::min(chunkSize, numSamples - start));
+
+    for (auto k = 0UL; k < blockSize; ++k)
+      std::copy_n(audio.getReadPointer(static_cast<int>(firstChannel + k), start),
+                  length,
+                  input[k].begin());
+
+    if (crossfade)
+      for (auto i = 0UL; i < length; ++i)
+        fade[i] = static_cast<float>(static_cast<size_t>(start) + i + 1) /
+                  static_cast<float>(numSamples);
+
+    for (auto row = 0UL; row < blockSize; ++row)
+    {
+      const auto& gains = _current[firstChannel + row];
+      auto* const output = audio.getWritePointer(static_cast<int>(firstChannel + row), start);
+
+      std::fill_n(output, length, 0.0f);
+      for (auto k = 0UL; k < blockSize; ++k)
+      {
+        const auto gain = gains[firstChannel + k];
+        for (auto i = 0UL; i < length; ++i)
+          output[i] += gain * input[k][i];
+      }
+
+      if (!crossfade)
+        continue;
+
+      const auto& differences = _difference[firstChannel + row];
+      std::fill_n(faded.begin(), length, 0.0f);
+      for (auto k = 0UL; k < blockSize; ++k)
+      {
+        const auto difference = differences[firstChannel + k];
+        for (auto i = 0UL; i < length; ++i)
+          faded[i] += difference * input[k][i];
+      }
+
+      for (auto i = 0UL; i < length; ++i)
+        output[i] += fade[i] * faded[i];
+    }
+  }
+}
+
+static_assert(fsh::util::maxAmbiOrder == 5, "update the explicit instantiations below");
+template class fsh::fx::AmbisonicRotator<1>;
+template class fsh::fx::AmbisonicRotator<2>;
+template class fsh::fx::AmbisonicRotator<3>;
+template class fsh::fx::AmbisonicRotator<4>;
+template class fsh::fx::AmbisonicRotator<5>;
@@ -0,0 +1,90 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "SphericalHarmonics.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace fsh::fx
+{
+/**
+Rotates an Ambisonics sound field.
+
+A rotation of the sound field maps the channels of each order onto the channels of the same order,
+so the rotation matrix is block-diagonal, with one `(2n + 1) x (2n + 1)` block for each order `n`.
+The blocks are computed with the recurrence from Ivanic & Ruedenberg ("Rotation Matrices for Real
+Spherical Harmonics. Direct Determination by Recursion", 1996/1998), starting from the 3x3
+rotation matrix for first order. This is only done when the angles change.
+
+The angles follow the same conventions as util::SphericalVector:
+
+- a positive yaw moves sources clockwise, i.e. in the direction of increasing azimuth,
+- a positive pitch moves sources in front of the listener upwards,
+- a positive roll moves sources to the right of the listener upwards.
+
+The rotations are applied in the order roll, pitch, yaw. When the angles change, the output is
+crossfaded from the old to the new rotation over the next block.
+
+**Before using:** set the angles using setParams().
+
+**To use:** call process() once per block, which rotates the first `(Order + 1) ^ 2` channels of
+the buffer in place.
+*/
+template<int Order = util::maxAmbiOrder>
+class AmbisonicRotator
+{
+public:
+  /// Number of channels that are rotated.
+  static constexpr auto numChannels = util::numChannelsForOrder(Order);
+
+  /// Parameters for AmbisonicRotator.
+  struct Params
+  {
+    double yaw = 0.0;   ///< rotation around the vertical axis in degrees
+    double pitch = 0.0; ///< rotation around the left-right axis in degrees
+    double roll = 0.0;  ///< rotation around the front-back axis in degrees
+  };
+
+  /// Create a rotator with no rotation.
+  AmbisonicRotator();
+
+  /// Set the rotation angles. The rotation matrix is only recomputed if the angles change.
+  void setParams(const Params&);
+
+  /// Rotate the sound field in the given buffer in place.
+  void process(juce::AudioBuffer<float>&);
+
+  /// Jump to the current angles, without crossfading.
+  void reset();
+
+private:
+  // Only the blocks on the diagonal are ever used:
+  using Matrix = std::array<std::array<float, numChannels>, numChannels>;
+
+  void processOrder(int order, juce::AudioBuffer<float>&, bool crossfade);
+
+  Params _params;
+  Matrix _current = {};
+  Matrix _target = {};
+  Matrix _difference = {};
+  bool _changed = false;
+};
+} // namespace fsh::fx
@@ -0,0 +1,227 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "BinauralDecoder.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <optional>
+#include <spdlog/spdlog.h>
+
+using namespace fsh::fx;
+
+namespace
+{
+auto readWav(const std::filesystem::path& path) -> std::optional<juce::AudioBuffer<float>>
+{
+  auto formats = juce::AudioFormatManager{};
+  formats.registerBasicFormats();
+
+  const auto file = juce::File{ std::filesystem::absolute(path).string() };
+  const auto reader = std::unique_ptr<juce::AudioFormatReader>{ formats.createReaderFor(file) };
+  if (reader == nullptr)
+  {
+    spdlog::error("BinauralDecoder: could not read audio file {}", path.string());
+    return {};
+  }
+
+  const auto numChannels = static_cast<int>(reader->numChannels);
+  const auto length = static_cast<int>(reader->lengthInSamples);
+  auto filters = juce::AudioBuffer<float>{ numChannels, length };
+  reader->read(&filters, 0, length, 0, true, true);
+  return filters;
+}
+
+auto readRaw(const std::filesystem::path& path) -> std::optional<juce::AudioBuffer<float>>
+{
+  constexpr auto numChannels = 2 * fsh::util::maxNumChannels;
+
+  auto file = std::ifstream{ path, std::ios::binary | std::ios::ate };
+  if (!file)
+  {
+    spdlog::error("BinauralDecoder: could not open file {}", path.string());
+    return {};
+  }
+
+  const auto numBytes = static_cast<size_t>(file.tellg());
+  const auto bytesPerFrame = numChannels * sizeof(float);
+  if (numBytes == 0 || numBytes % bytesPerFrame != 0)
+  {
+    spdlog::error("BinauralDecoder: size of raw file {} is not a multiple of {} channels",
+                  path.string(),
+                  numChannels);
+    return {};
+  }
+
+  const auto length = numBytes / bytesPerFrame;
+  auto filters = juce::AudioBuffer<float>{ numChannels, static_cast<int>(length) };
+  file.seekg(0);
+  for (auto ch = 0; ch < numChannels && file; ++ch)
+    file.read(reinterpret_cast<char*>(filters.getWritePointer(ch)),
+              static_cast<std::streamsize>(length * sizeof(float)));
+
+  if (!file)
+  {
+    spdlog::error("BinauralDecoder: error reading raw file {}", path.string());
+    return {};
+  }
+  return filters;
+}
+} // namespace
+
+template<int Order>
+auto BinauralDecoder<Order>::loadFilters(const std::filesystem::path& path) -> bool
+{
+  auto extension = path.extension().string();
+  for (auto& c : extension)
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+  const auto filters = extension == ".wav" ? readWav(path) : readRaw(path);
+  return filters && setFilters(*filters);
+}
+
+template<int Order>
+auto BinauralDecoder<Order>::setFilters(const juce::AudioBuffer<float>& filters) -> bool
+{
+  const auto numFilters = filters.getNumChannels();
+  const auto fileOrder = util::orderForNumChannels(numFilters / 2);
+  if (numFilters % 2 != 0 || fileOrder < Order)
+  {
+    spdlog::error("BinauralDecoder: need filters for order {} ({} channels), got {} channels",
+                  Order,
+                  2 * numChannels,
+                  numFilters);
+    return false;
+  }
+
+  const auto length = static_cast<size_t>(filters.getNumSamples());
+  if (length == 0)
+  {
+    spdlog::error("BinauralDecoder: filters are empty");
+    return false;
+  }
+  if (length > maxFilterLength)
+    spdlog::warn("BinauralDecoder: filters truncated from {} to {} samples",
+                 length,
+                 maxFilterLength);
+
+  const auto usedLength = std::min(length, maxFilterLength);
+  auto convolver =
+    std::make_unique<util::PartitionedConvolver>(numChannels, 2, blockSize, usedLength);
+
+  const auto channelsPerEar = numFilters / 2;
+  for (auto ear = 0; ear < 2; ++ear)
+    for (auto ch = 0UL; ch < numChannels; ++ch)
+    {
+      const auto channel = ear * channelsPerEar + static_cast<int>(ch);
+      const auto filter = std::span{ filters.getReadPointer(channel), usedLength };
+      convolver->setFilter(ch, static_cast<size_t>(ear), filter);
+    }
+
+  _convolver = std::move(convolver);
+  reset();
+  return true;
+}
+
+template<int Order>
+auto BinauralDecoder<Order>::hasFilters() const -> bool
+{
+  return _convolver != nullptr;
+}
+
+template<int Order>
+auto BinauralDecoder<Order>::latencySamples() const -> int
+{
+  return static_cast<int>(blockSize);
+}
+
+template<int Order>
+void BinauralDecoder<Order>::reset()
+{
+  for (auto& channel : _inputBlock)
+    channel.fill(0.0f);
+  for (auto& ear : _outputBlock)
+    ear.fill(0.0f);
+  _blockPosition = 0;
+
+  if (_convolver != nullptr)
+    _convolver->reset();
+}
+
+template<int Order>
+void BinauralDecoder<Order>::process(juce::AudioBuffer<float>& audio)
+{
+  if (static_cast<size_t>(audio.getNumChannels()) < numChannels)
+  {
+    audio.clear();
+    return spdlog::error("BinauralDecoder: need {} channels, got {}",
+                         numChannels,
+                         audio.getNumChannels());
+  }
+
+  if (_convolver == nullptr)
+    return audio.clear();
+
+  auto inputs = std::array<const float*, numChannels>{};
+  for (auto ch = 0UL; ch < numChannels; ++ch)
+    inputs[ch] = _inputBlock[ch].data();
+  const auto outputs = std::array<float*, 2>{ _outputBlock[0].data(), _outputBlock[1].data() };
+
+  // The input is collected into blocks of blockSize samples. Each chunk of input samples is
+  // replaced by the same number of output samples from the previous block, so the ear signals can
+  // be written to the same buffer once the chunk has been read:
+  const auto numSamples = static_cast<size_t>(audio.getNumSamples());
+  for (auto start = 0UL; start < numSamples;)
+  {
+    const auto length = std::min(numSamples - start, blockSize - _blockPosition);
+    const auto offset = static_cast<std::ptrdiff_t>(_blockPosition);
+
+    for (auto ch = 0UL; ch < numChannels; ++ch)
+      std::copy_n(audio.getReadPointer(static_cast<int>(ch), static_cast<int>(start)),
+                  length,
+                  _inputBlock[ch].begin() + offset);
+
+    for (auto ear = 0UL; ear < 2; ++ear)
+      std::copy_n(_outputBlock[ear].begin() + offset,
+                  length,
+                  audio.getWritePointer(static_cast<int>(ear), static_cast<int>(start)));
+
+    _blockPosition += length;
+    start += length;
+
+    if (_blockPosition == blockSize)
+    {
+      _convolver->process(inputs.data(), outputs.data());
+      _blockPosition = 0;
+    }
+  }
+
+  for (auto ch = 2; ch < audio.getNumChannels(); ++ch)
+    audio.clear(ch, 0, audio.getNumSamples());
+}
+
+static_assert(fsh::util::maxAmbiOrder == 5, "update the explicit instantiations below");
+template class fsh::fx::BinauralDecoder<1>;
+template class fsh::fx::BinauralDecoder<2>;
+template class fsh::fx::BinauralDecoder<3>;
+template class fsh::fx::BinauralDecoder<4>;
+template class fsh::fx::BinauralDecoder<5>;
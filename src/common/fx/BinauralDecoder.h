@@ -0,0 +1,100 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "PartitionedConvolver.h"
+#include "SphericalHarmonics.h"
+#include <filesystem>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <memory>
+
+namespace fsh::fx
+{
+/**
+Renders Ambisonics to binaural stereo for headphones.
+
+Each ambisonic channel is convolved with one filter per ear, and the results are summed, using a
+util::PartitionedConvolver. The filters are derived from a set of head-related impulse responses
+(e.g. with the MagLS method), which is done offline. They are loaded from a file with
+`2 * (N + 1) ^ 2` channels for some order N at least as high as the decoder's order: first the
+filters for the left ear, one per ambisonic channel in ACN order, then the filters for the right
+ear. If the file has a higher order than the decoder, the extra channels are ignored. Two file
+formats are supported:
+
+- **WAV** (or any other format JUCE can read), if the file name ends in `.wav`.
+- **Raw**, for any other file name: 32-bit floats in native byte order, with the channels one after
+  the other (not interleaved). Raw files always contain filters for maxAmbiOrder, and the length of
+  the filters is determined by the file size.
+
+The filters need to have the same sample rate as the audio, since they are not resampled.
+
+The convolution runs on blocks of blockSize samples, so the output is delayed by latencySamples()
+samples, regardless of the host's block size.
+
+**Before using:** load the filters using loadFilters(). This allocates memory and transforms the
+filters, so it should not be done on the audio thread, nor while process() is running.
+
+**To use:** call process() once per block.
+*/
+template<int Order = util::maxAmbiOrder>
+class BinauralDecoder
+{
+public:
+  /// Number of ambisonic input channels.
+  static constexpr auto numChannels = util::numChannelsForOrder(Order);
+
+  /// Number of samples per block of the convolution, and per filter partition.
+  static constexpr size_t blockSize = 256;
+
+  /// Maximum length of the filters in samples.
+  static constexpr size_t maxFilterLength = 8192;
+
+  /// Load a set of filters from a file. Returns false, and keeps the current filters, if the file
+  /// can't be read.
+  auto loadFilters(const std::filesystem::path&) -> bool;
+
+  /// Set the filters from a buffer with the channel layout described above.
+  auto setFilters(const juce::AudioBuffer<float>&) -> bool;
+
+  /// Returns true once filters have been set.
+  auto hasFilters() const -> bool;
+
+  /// The delay of the output in samples.
+  auto latencySamples() const -> int;
+
+  /// Render one block in place. The first numChannels channels are read, the left and right ear
+  /// signals are written to the first two channels, and all other channels are cleared. This
+  /// works directly on an ambisonic buffer with at least numChannels channels, like the one
+  /// rendered by the ambisonium synth. The output is silent if no filters have been set.
+  void process(juce::AudioBuffer<float>&);
+
+  /// Clear the audio that is still in the convolution.
+  void reset();
+
+private:
+  std::unique_ptr<util::PartitionedConvolver> _convolver;
+
+  // Input and output blocks of the convolution, and the number of samples that are filled:
+  std::array<std::array<float, blockSize>, numChannels> _inputBlock = {};
+  std::array<std::array<float, blockSize>, 2> _outputBlock = {};
+  size_t _blockPosition = 0;
+};
+} // namespace fsh::fx
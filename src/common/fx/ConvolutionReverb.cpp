@@ -0,0 +1,274 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "ConvolutionReverb.h"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <optional>
+#include <spdlog/spdlog.h>
+
+using namespace fsh::fx;
+
+namespace
+{
+// Increment this whenever the format of the cache files, or the layout of the convolver, changes:
+constexpr auto cacheVersion = 1;
+
+auto readWav(const std::filesystem::path& path) -> std::optional<juce::AudioBuffer<float>>
+{
+  auto formats = juce::AudioFormatManager{};
+  formats.registerBasicFormats();
+
+  const auto file = juce::File{ std::filesystem::absolute(path).string() };
+  const auto reader = std::unique_ptr<juce::AudioFormatReader>{ formats.createReaderFor(file) };
+  if (reader == nullptr)
+  {
+    spdlog::error("ConvolutionReverb: could not read audio file {}", path.string());
+    return {};
+  }
+
+  const auto numChannels = static_cast<int>(reader->numChannels);
+  const auto length = static_cast<int>(reader->lengthInSamples);
+  auto ir = juce::AudioBuffer<float>{ numChannels, length };
+  reader->read(&ir, 0, length, 0, true, true);
+  return ir;
+}
+
+// Identifies an audio file and the reverb it is loaded into. The cached impulse response is only
+// used if this matches exactly, so it is reloaded whenever the file is changed:
+auto cacheKey(const std::filesystem::path& path, size_t numChannels) -> std::optional<std::string>
+{
+  auto error = std::error_code{};
+  const auto absolutePath = std::filesystem::absolute(path, error);
+  const auto size = std::filesystem::file_size(path, error);
+  const auto modified = std::filesystem::last_write_time(path, error);
+  if (error)
+    return {};
+
+  return fmt::format("fsh::fx::ConvolutionReverb {}\n{}\n{}\n{}\n{}",
+                     cacheVersion,
+                     absolutePath.string(),
+                     size,
+                     modified.time_since_epoch().count(),
+                     numChannels);
+}
+
+auto cacheFileName(const std::string& key) -> std::string
+{
+  return fmt::format("{:016x}.ir", std::hash<std::string>{}(key));
+}
+} // namespace
+
+template<int Order>
+auto ConvolutionReverb<Order>::loadImpulseResponse(const std::filesystem::path& path,
+                                                   const std::filesystem::path& cacheDirectory)
+  -> bool
+{
+  const auto key = cacheKey(path, numChannels);
+  const auto cacheFile = key ? cacheDirectory / cacheFileName(*key) : std::filesystem::path{};
+  if (key && readCache(cacheFile, *key))
+    return true;
+
+  const auto ir = readWav(path);
+  if (!ir || !setImpulseResponse(*ir))
+    return false;
+
+  if (key)
+    writeCache(cacheFile, *key);
+  return true;
+}
+
+template<int Order>
+auto ConvolutionReverb<Order>::setImpulseResponse(const juce::AudioBuffer<float>& ir) -> bool
+{
+  if (static_cast<size_t>(ir.getNumChannels()) < numChannels)
+  {
+    spdlog::error("ConvolutionReverb: need an impulse response for order {} ({} channels), got {}",
+                  Order,
+                  numChannels,
+                  ir.getNumChannels());
+    return false;
+  }
+
+  const auto length = static_cast<size_t>(ir.getNumSamples());
+  if (length == 0)
+  {
+    spdlog::error("ConvolutionReverb: impulse response is empty");
+    return false;
+  }
+  if (length > maxLength)
+    spdlog::warn("ConvolutionReverb: impulse response truncated from {} to {} samples",
+                 length,
+                 maxLength);
+
+  const auto usedLength = std::min(length, maxLength);
+  auto convolver = std::make_unique<util::NonUniformConvolver>(numChannels, usedLength);
+  for (auto ch = 0UL; ch < numChannels; ++ch)
+    convolver->setFilter(ch, std::span{ ir.getReadPointer(static_cast<int>(ch)), usedLength });
+
+  _convolver = std::move(convolver);
+  reset();
+  return true;
+}
+
+template<int Order>
+auto ConvolutionReverb<Order>::readCache(const std::filesystem::path& cacheFile,
+                                         const std::string& key) -> bool
+{
+  auto file = std::ifstream{ cacheFile, std::ios::binary };
+  if (!file)
+    return false;
+
+  // The file starts with its key, and the length of the impulse response:
+  auto keySize = uint64_t{};
+  file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
+  if (!file || keySize != key.size())
+    return false;
+
+  auto fileKey = std::string(key.size(), '\0');
+  auto length = uint64_t{};
+  file.read(fileKey.data(), static_cast<std::streamsize>(fileKey.size()));
+  file.read(reinterpret_cast<char*>(&length), sizeof(length));
+  if (!file || fileKey != key || length == 0 || length > maxLength)
+    return false;
+
+  auto convolver = std::make_unique<util::NonUniformConvolver>(numChannels, length);
+  if (!convolver->readFilters(file))
+  {
+    spdlog::warn("ConvolutionReverb: ignoring invalid cache file {}", cacheFile.string());
+    return false;
+  }
+
+  _convolver = std::move(convolver);
+  reset();
+  return true;
+}
+
+template<int Order>
+void ConvolutionReverb<Order>::writeCache(const std::filesystem::path& cacheFile,
+                                          const std::string& key) const
+{
+  auto error = std::error_code{};
+  std::filesystem::create_directories(cacheFile.parent_path(), error);
+
+  // The file is written under a temporary name first, so other instances never read a partially
+  // written file:
+  auto temporaryFile = cacheFile;
+  temporaryFile += ".tmp";
+  {
+    auto file = std::ofstream{ temporaryFile, std::ios::binary };
+    const auto keySize = uint64_t{ key.size() };
+    const auto length = uint64_t{ _convolver->filterLength() };
+    file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+    file.write(key.data(), static_cast<std::streamsize>(key.size()));
+    file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    _convolver->writeFilters(file);
+
+    if (!file)
+    {
+      spdlog::warn("ConvolutionReverb: could not write cache file {}", temporaryFile.string());
+      file.close();
+      std::filesystem::remove(temporaryFile, error);
+      return;
+    }
+  }
+
+  std::filesystem::rename(temporaryFile, cacheFile, error);
+  if (error)
+  {
+    spdlog::warn("ConvolutionReverb: could not write cache file {}", cacheFile.string());
+    std::filesystem::remove(temporaryFile, error);
+  }
+}
+
+template<int Order>
+auto ConvolutionReverb<Order>::hasImpulseResponse() const -> bool
+{
+  return _convolver != nullptr;
+}
+
+template<int Order>
+void ConvolutionReverb<Order>::setDryWet(float dryWet)
+{
+  _dryWet = std::clamp(dryWet, 0.0f, 1.0f);
+}
+
+template<int Order>
+auto ConvolutionReverb<Order>::latencySamples() const -> int
+{
+  return static_cast<int>(util::NonUniformConvolver::headBlockSize);
+}
+
+template<int Order>
+void ConvolutionReverb<Order>::reset()
+{
+  if (_convolver != nullptr)
+    _convolver->reset();
+}
+
+template<int Order>
+void ConvolutionReverb<Order>::process(juce::AudioBuffer<float>& audio)
+{
+  const auto numAudioChannels = std::min(static_cast<size_t>(audio.getNumChannels()), numChannels);
+  if (_convolver == nullptr || numAudioChannels == 0)
+    return;
+
+  auto outputs = std::array<float*, numChannels>{};
+  for (auto ch = 0UL; ch < numChannels; ++ch)
+    outputs[ch] = _wet[ch].data();
+
+  const auto wetGain = _dryWet;
+  const auto dryGain = 1.0f - _dryWet;
+
+  // The omnidirectional channel W excites the room, which then reverberates in all channels:
+  const auto numSamples = static_cast<size_t>(audio.getNumSamples());
+  for (auto start = 0UL; start < numSamples; start += util::NonUniformConvolver::headBlockSize)
+  {
+    const auto length = std::min(numSamples - start, util::NonUniformConvolver::headBlockSize);
+    _convolver->process(audio.getReadPointer(0, static_cast<int>(start)), outputs.data(), length);
+
+    for (auto ch = 0UL; ch < numAudioChannels; ++ch)
+    {
+      auto* const samples = audio.getWritePointer(static_cast<int>(ch), static_cast<int>(start));
+      for (auto i = 0UL; i < length; ++i)
+        samples[i] = (samples[i] * dryGain) + (_wet[ch][i] * wetGain);
+    }
+  }
+}
+
+template<int Order>
+auto ConvolutionReverb<Order>::defaultCacheDirectory() -> std::filesystem::path
+{
+  const auto directory =
+    juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+      .getChildFile("fshstk")
+      .getChildFile("ImpulseResponseCache");
+  return directory.getFullPathName().toStdString();
+}
+
+static_assert(fsh::util::maxAmbiOrder == 5, "update the explicit instantiations below");
+template class fsh::fx::ConvolutionReverb<1>;
+template class fsh::fx::ConvolutionReverb<2>;
+template class fsh::fx::ConvolutionReverb<3>;
+template class fsh::fx::ConvolutionReverb<4>;
+template class fsh::fx::ConvolutionReverb<5>;
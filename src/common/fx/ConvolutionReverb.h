@@ -0,0 +1,107 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "NonUniformConvolver.h"
+#include "SphericalHarmonics.h"
+#include <array>
+#include <filesystem>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <memory>
+
+namespace fsh::fx
+{
+/**
+Ambisonic convolution reverb, using a measured room impulse response.
+
+The impulse response is an ambisonic recording of a room, excited by an omnidirectional source: one
+channel per ambisonic channel, in ACN order, with the same normalization as the audio. The
+omnidirectional channel W of the audio is convolved with each channel of the impulse response, and
+the results are mixed into the corresponding ambisonic channels, so the reflections arrive from the
+directions they were recorded from. If the impulse response has a higher order than the reverb,
+the extra channels are ignored.
+
+The convolution uses a util::NonUniformConvolver, so the first few thousand samples of the impulse
+response are convolved on the audio thread, and the rest on background threads. The reverberated
+signal is delayed by latencySamples() samples, which sounds like a short pre-delay. The dry signal
+is not delayed.
+
+Impulse responses can be several seconds long, so transforming them takes a while. So
+loadImpulseResponse() caches the transformed impulse response in a file, and reuses it as long as
+the audio file hasn't changed.
+
+The impulse response needs to have the same sample rate as the audio, since it is not resampled.
+
+**Before using:** load an impulse response using loadImpulseResponse(). This allocates memory and
+starts threads, so it should not be done on the audio thread, nor while process() is running.
+
+**To use:** call process() once per block. Without an impulse response, the audio is unchanged.
+*/
+template<int Order = util::maxAmbiOrder>
+class ConvolutionReverb
+{
+public:
+  /// Number of ambisonic channels.
+  static constexpr auto numChannels = util::numChannelsForOrder(Order);
+
+  /// Maximum length of the impulse response in samples, about 11 seconds at 48 kHz.
+  static constexpr size_t maxLength = size_t{ 1 } << 19;
+
+  /// Load an impulse response from a WAV file (or any other format JUCE can read). The transformed
+  /// impulse response is cached in the given directory. Returns false, and keeps the current
+  /// impulse response, if the file can't be read.
+  auto loadImpulseResponse(const std::filesystem::path&,
+                           const std::filesystem::path& cacheDirectory = defaultCacheDirectory())
+    -> bool;
+
+  /// Set the impulse response from a buffer, without caching it.
+  auto setImpulseResponse(const juce::AudioBuffer<float>&) -> bool;
+
+  /// Returns true once an impulse response has been set.
+  auto hasImpulseResponse() const -> bool;
+
+  /// Set the dry/wet mix [0, 1].
+  void setDryWet(float);
+
+  /// The delay of the reverberated signal in samples.
+  auto latencySamples() const -> int;
+
+  /// Apply the reverb in place. The first channel is used as the input, and the first numChannels
+  /// channels are written.
+  void process(juce::AudioBuffer<float>&);
+
+  /// Clear the audio that is still in the convolution.
+  void reset();
+
+  /// A directory for cached impulse responses in the user's application data directory.
+  static auto defaultCacheDirectory() -> std::filesystem::path;
+
+private:
+  auto readCache(const std::filesystem::path& cacheFile, const std::string& key) -> bool;
+  void writeCache(const std::filesystem::path& cacheFile, const std::string& key) const;
+
+  std::unique_ptr<util::NonUniformConvolver> _convolver;
+  float _dryWet = 0.5f;
+
+  // The reverberated signal of one chunk of audio:
+  std::array<std::array<float, util::NonUniformConvolver::headBlockSize>, numChannels> _wet = {};
+};
+} // namespace fsh::fx
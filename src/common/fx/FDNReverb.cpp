@@ -20,79 +20,89 @@
 ***************************************************************************************************/
 
 #include "FDNReverb.h"
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
 using namespace fsh::fx;
 
 namespace
 {
-const auto presets = std::map<FDNReverb::Preset, FDNReverb::Params>{
-  { FDNReverb::Preset::Off,
+const auto presets = std::map<ReverbPreset, ReverbParams>{
+  { ReverbPreset::Off,
     {
       .roomSize = 0.0f,
       .revTime = 0.0f,
+      .revTimeHigh = 0.0f,
       .dryWet = 0.0f,
     } },
-  { FDNReverb::Preset::Earth,
+  { ReverbPreset::Earth,
     {
       .roomSize = 1.0f,
       .revTime = 0.8f,
+      .revTimeHigh = 0.4f,
       .dryWet = 0.8f,
     } },
-  { FDNReverb::Preset::Metal,
+  { ReverbPreset::Metal,
     {
       .roomSize = 15.0f,
       .revTime = 1.5f,
+      .revTimeHigh = 1.2f,
       .dryWet = 0.8f,
     } },
-  { FDNReverb::Preset::Sky,
+  { ReverbPreset::Sky,
     {
       .roomSize = 30.0f,
       .revTime = 3.0f,
+      .revTimeHigh = 1.8f,
       .dryWet = 0.8f,
     } },
 };
 
-const auto numPrimes = 5'000;
-auto generatePrimes(size_t count = numPrimes)
+// The first prime numbers, computed at compile time with a sieve of Eratosthenes. Even at the
+// longest reverberation time, the delay lines only use the first few hundred of them:
+constexpr auto numPrimes = size_t{ 1024 };
+constexpr auto primeNumbers = []
 {
-  std::vector<unsigned> primes;
-  primes.reserve(count);
+  constexpr auto limit = 8192U; // the 1024th prime is 8161
 
-  const auto isPrime = [](unsigned n)
-  {
-    if (n == 0 || n == 1)
-      return false;
-    for (auto i = 2U; i * i <= n; ++i)
-      if (n % i == 0)
-        return false;
-    return true;
-  };
-
-  primes.push_back(2U);
-  auto i = 3U;
+  std::array<bool, limit> composite = {};
+  std::array<unsigned, numPrimes> primes = {};
+  auto count = size_t{ 0 };
 
-  while (primes.size() < count)
+  for (auto n = 2U; n < limit && count < numPrimes; ++n)
   {
-    if (isPrime(i))
-      primes.push_back(i);
-    i += 2;
+    if (composite[n])
+      continue;
+
+    primes[count++] = n;
+    for (auto multiple = n * n; multiple < limit; multiple += n)
+      composite[multiple] = true;
   }
 
   return primes;
-}
+}();
+static_assert(primeNumbers.back() == 8161, "the sieve limit is too small for numPrimes");
+
+// The prime indices are spread so that the delays cover about the same range for any number of
+// lines as they do for 64 lines, i.e. fewer lines are spaced further apart:
+constexpr auto referenceSize = size_t{ 64 };
 
-template<size_t numIndices = FDNReverb::fdnSize>
+template<size_t numIndices>
 auto generateIndices(unsigned delayLength)
 {
+  constexpr auto minSpacing = std::max(referenceSize / numIndices, size_t{ 1 });
+
   std::array<size_t, numIndices> indices;
   indices[0] = std::max(delayLength / 10UL, 1UL);
 
   for (auto i = 1U; i < numIndices; i++)
-    indices[i] = indices[i - 1] + std::max(i * delayLength / numIndices, size_t{ 1 });
+  {
+    const auto spacing = i * delayLength * referenceSize / (numIndices * numIndices);
+    indices[i] = indices[i - 1] + std::max(spacing, minSpacing);
+  }
 
   for (auto i = 0U; i < numIndices; ++i)
-    if (indices[i] > numPrimes)
+    if (indices[i] >= numPrimes)
     {
       spdlog::warn("index {} is greater than numPrimes {}, replacing with {}",
                    indices[i],
@@ -104,101 +114,302 @@ auto generateIndices(unsigned delayLength)
   return indices;
 }
 
-/// Fast Hadamard-Walsh transform (FWHT) in-place.
-void fwht(std::array<float, FDNReverb::fdnSize>& data)
+// Whether all values of a frame are below the silence threshold:
+template<size_t Size>
+auto isQuiet(const float* frame) -> bool
 {
-  static_assert(FDNReverb::fdnSize == 64, "FDN size must be power of 2");
-  const auto numElements = data.size();
-  const auto logSize = static_cast<unsigned>(std::log2(numElements));
+  // Counting instead of breaking out early keeps the loop vectorizable:
+  auto numLoud = 0U;
+  for (auto i = 0UL; i < Size; ++i)
+    numLoud += std::abs(frame[i]) >= FDNReverb<Size>::silenceThreshold ? 1U : 0U;
+  return numLoud == 0;
+}
 
-  for (auto i = 0U; i < logSize; ++i)
-    for (auto j = 0U; j < data.size(); j += (1 << (i + 1)))
-      for (auto k = 0U; k < (1U << i); ++k)
-      {
-        const auto x = j + k;
-        const auto y = j + k + (1 << i);
-        const auto a = data[x];
-        const auto b = data[y];
-        data[x] = a + b;
-        data[y] = a - b;
-      }
+// Whether the first channels of a buffer are below the silence threshold:
+template<size_t Size>
+auto isSilent(const juce::AudioBuffer<float>& buffer, size_t numChannels) -> bool
+{
+  for (auto channel = 0UL; channel < numChannels; ++channel)
+    if (buffer.getMagnitude(static_cast<int>(channel), 0, buffer.getNumSamples()) >=
+        FDNReverb<Size>::silenceThreshold)
+      return false;
+  return true;
+}
 
-  const auto norm = std::sqrt(static_cast<float>(numElements));
-  for (auto i = 0U; i < numElements; ++i)
-    data[i] /= norm;
+// Delay line lengths are a tenth of a millisecond per prime number:
+auto delaySeconds(unsigned prime) -> double
+{
+  return 0.0001 * prime;
 }
 } // namespace
 
-FDNReverb::FDNReverb()
-  : primeNumbers(generatePrimes())
+template<size_t Size>
+FDNReverb<Size>::FDNReverb()
 {
-  updateParameterSettings();
+  updateParameterSettings(false);
 }
 
-void FDNReverb::process(juce::AudioBuffer<float>& buffer)
+template<size_t Size>
+void FDNReverb<Size>::process(juce::AudioBuffer<float>& buffer)
 {
   const auto numChannels = static_cast<size_t>(buffer.getNumChannels());
   const auto numChannelsToProcess = std::min(numChannels, fdnSize);
-  const auto numSamples = buffer.getNumSamples();
+
+  if (delayLines.numLines() == 0)
+    return spdlog::error("FDNReverb: setSampleRate() must be called before process()");
 
   if (fdnSize < numChannels)
     spdlog::error(
       "FDN size is smaller than number of channels in buffer. Only processing first {} channels.",
       fdnSize);
 
+  // With all delay lines cleared, the FDN passes its input through unchanged, so there is nothing
+  // to do until the input is no longer silent:
+  if (idle)
+  {
+    if (isSilent<fdnSize>(buffer, numChannelsToProcess))
+      return;
+    idle = false;
+  }
+
+  switch (processingMode)
+  {
+    case ProcessingMode::Block:
+      processBlock(buffer, numChannelsToProcess);
+      break;
+    case ProcessingMode::PerSample:
+      processPerSample(buffer, numChannelsToProcess);
+      break;
+  }
+
+  // Once nothing but silence has been written to the delay lines for longer than the longest
+  // delay, the tail is over. The lines are cleared, so the bypass above is exact:
+  const auto longestDelay = *std::max_element(delayLengths.begin(), delayLengths.end());
+  if (quietSamples > longestDelay && crossfadeSamplesLeft == 0)
+  {
+    reset();
+    idle = true;
+  }
+}
+
+template<size_t Size>
+void FDNReverb<Size>::processBlock(juce::AudioBuffer<float>& buffer, size_t numChannelsToProcess)
+{
+  const auto numSamples = static_cast<size_t>(buffer.getNumSamples());
+  const auto wetGain = params.dryWet;
+  const auto dryGain = 1.0f - params.dryWet;
+
+  // While crossfading, the chunks must not be longer than the old delays either:
+  auto shortestDelay = *std::min_element(delayLengths.begin(), delayLengths.end());
+  if (crossfadeSamplesLeft > 0)
+    shortestDelay = std::min(
+      shortestDelay, *std::min_element(previousDelayLengths.begin(), previousDelayLengths.end()));
+
+  auto gains = std::array<float, fdnSize>{};
+  auto highGains = std::array<float, fdnSize>{};
+
+  for (auto start = 0UL; start < numSamples;)
+  {
+    const auto length = std::min({ numSamples - start, shortestDelay, maxChunkLength });
+    const auto fadeLength = std::min(length, crossfadeSamplesLeft);
+
+    // Everything that is independent for each line is done a whole line at a time:
+    for (auto channel = 0UL; channel < fdnSize; ++channel)
+    {
+      auto* delayed = lineChunk.data();
+      delayLines.readBlock(channel, delayLengths[channel], delayed, length);
+
+      if (fadeLength > 0)
+      {
+        // Same as in processPerSample(), for each sample of the crossfade in this chunk:
+        delayLines.readBlock(
+          channel, previousDelayLengths[channel], previousChunk.data(), fadeLength);
+
+        for (auto i = 0UL; i < fadeLength; ++i)
+        {
+          const auto fade = 1.0f - static_cast<float>(crossfadeSamplesLeft - i) /
+                                     static_cast<float>(crossfadeLength);
+          delayed[i] = (1.0f - fade) * previousChunk[i] + fade * delayed[i];
+        }
+      }
+
+      if (channel < numChannelsToProcess)
+      {
+        auto* samples = buffer.getWritePointer(static_cast<int>(channel), static_cast<int>(start));
+        for (auto i = 0UL; i < length; ++i)
+        {
+          const auto input = samples[i];
+          delayed[i] += input;
+          samples[i] = (input * dryGain) + (delayed[i] * wetGain);
+        }
+      }
+
+      for (auto i = 0UL; i < length; ++i)
+        frames[i][channel] = delayed[i];
+    }
+
+    // ...and everything that mixes the lines a whole frame at a time:
+    for (auto i = 0UL; i < length; ++i)
+    {
+      if (i < fadeLength)
+      {
+        const auto fade = 1.0f - static_cast<float>(crossfadeSamplesLeft - i) /
+                                   static_cast<float>(crossfadeLength);
+        for (auto channel = 0UL; channel < fdnSize; ++channel)
+        {
+          gains[channel] =
+            (1.0f - fade) * previousFeedbackGains[channel] + fade * feedbackGains[channel];
+          highGains[channel] =
+            (1.0f - fade) * previousHighFeedbackGains[channel] + fade * highFeedbackGains[channel];
+        }
+        decayFilters.process(frames[i].data(), gains.data(), highGains.data());
+      }
+      else
+        decayFilters.process(frames[i].data(), feedbackGains.data(), highFeedbackGains.data());
+
+      hadamard(frames[i].data());
+      quietSamples = isQuiet<fdnSize>(frames[i].data()) ? quietSamples + 1 : 0;
+    }
+
+    for (auto channel = 0UL; channel < fdnSize; ++channel)
+    {
+      for (auto i = 0UL; i < length; ++i)
+        lineChunk[i] = frames[i][channel];
+      delayLines.writeBlock(channel, lineChunk.data(), length);
+    }
+    delayLines.advance(length);
+
+    crossfadeSamplesLeft -= fadeLength;
+    start += length;
+  }
+}
+
+template<size_t Size>
+void FDNReverb<Size>::processPerSample(juce::AudioBuffer<float>& buffer,
+                                       size_t numChannelsToProcess)
+{
+  const auto numSamples = buffer.getNumSamples();
+
+  auto delayed = std::array<float, fdnSize>{};
+  auto previousDelayed = std::array<float, fdnSize>{};
+  auto gains = feedbackGains;
+  auto highGains = highFeedbackGains;
+
   for (int i = 0; i < numSamples; ++i)
   {
+    delayLines.gather(delayLengths.data(), delayed.data());
+
+    if (crossfadeSamplesLeft > 0)
+    {
+      // Read the delay lines at both the old and the new lengths, and fade from old to new:
+      const auto fade = 1.0f - static_cast<float>(crossfadeSamplesLeft) /
+                                 static_cast<float>(crossfadeLength);
+      delayLines.gather(previousDelayLengths.data(), previousDelayed.data());
+
+      for (auto channel = 0UL; channel < fdnSize; ++channel)
+      {
+        delayed[channel] = (1.0f - fade) * previousDelayed[channel] + fade * delayed[channel];
+        gains[channel] =
+          (1.0f - fade) * previousFeedbackGains[channel] + fade * feedbackGains[channel];
+        highGains[channel] =
+          (1.0f - fade) * previousHighFeedbackGains[channel] + fade * highFeedbackGains[channel];
+      }
+    }
+
     for (auto channel = 0UL; channel < numChannelsToProcess; ++channel)
     {
       const auto input = buffer.getSample(static_cast<int>(channel), i);
-      delayBuffers[channel].add(input);
+      delayed[channel] += input;
 
       const auto wetGain = params.dryWet;
       const auto dryGain = 1.0f - params.dryWet;
-      const auto output = (input * dryGain) + (delayBuffers[channel].get() * wetGain);
+      const auto output = (input * dryGain) + (delayed[channel] * wetGain);
       buffer.setSample(static_cast<int>(channel), i, output);
     }
 
-    for (auto channel = 0UL; channel < transferVector.size(); ++channel)
-      transferVector[channel] = delayBuffers[channel].get() * feedbackGains[channel];
-
-    fwht(transferVector);
+    transferVector = delayed;
+    decayFilters.process(transferVector.data(), gains.data(), highGains.data());
 
-    for (auto channel = 0U; channel < delayBuffers.size(); ++channel)
+    if (crossfadeSamplesLeft > 0 && --crossfadeSamplesLeft == 0)
     {
-      delayBuffers[channel].set(transferVector[channel]);
-      delayBuffers[channel].incrementIndex();
+      gains = feedbackGains;
+      highGains = highFeedbackGains;
     }
+
+    hadamard(transferVector.data());
+    quietSamples = isQuiet<fdnSize>(transferVector.data()) ? quietSamples + 1 : 0;
+
+    delayLines.scatter(transferVector.data());
+    delayLines.advance();
   }
 }
 
-void FDNReverb::updateParameterSettings()
+template<size_t Size>
+void FDNReverb<Size>::updateParameterSettings(bool crossfade)
 {
-  const auto primeIndices = generateIndices(static_cast<unsigned>(params.revTime));
+  if (crossfade && delayLines.numLines() > 0)
+  {
+    // If a crossfade is still running, it's cut short and the new one starts from its target:
+    previousDelayLengths = delayLengths;
+    previousFeedbackGains = feedbackGains;
+    previousHighFeedbackGains = highFeedbackGains;
+    crossfadeSamplesLeft = crossfadeLength;
+  }
+  else
+    crossfadeSamplesLeft = 0;
+
+  const auto revTime = std::clamp(params.revTime, 0.0f, maxRevTime);
+  const auto revTimeHigh = std::clamp(params.revTimeHigh, 0.0f, maxRevTime);
+  const auto primeIndices = generateIndices<Size>(static_cast<unsigned>(revTime));
 
   for (auto channel = 0U; channel < fdnSize; ++channel)
   {
     const auto primeIndex = primeIndices[channel];
     const auto primeNumber = primeNumbers[primeIndex];
 
-    const auto delayLengthMilliseconds = 0.1 * primeNumber;
-    const auto delayLengthSeconds = 0.001 * delayLengthMilliseconds;
+    const auto delayLengthSeconds = delaySeconds(primeNumber);
     const auto delayLengthSamples = static_cast<size_t>(delayLengthSeconds * sampleRate);
-    delayBuffers[channel].resize(delayLengthSamples);
-
-    const auto gain = juce::Decibels::decibelsToGain(-60.0 / params.revTime);
-    const auto feedback = std::pow(gain, delayLengthSeconds);
+    delayLengths[channel] =
+      std::clamp(delayLengthSamples, size_t{ 1 }, std::max(maxDelayLengths[channel], size_t{ 1 }));
+
+    // Each line decays by 60 dB per reverberation time, separately below and above the crossover.
+    // The Hadamard transform is not normalized, so its normalization is folded into the gains:
+    const auto normalization = std::sqrt(double{ fdnSize });
+    const auto gain = juce::Decibels::decibelsToGain(-60.0 / revTime);
+    const auto highGain = juce::Decibels::decibelsToGain(-60.0 / revTimeHigh);
+    const auto feedback = std::pow(gain, delayLengthSeconds) / normalization;
+    const auto highFeedback = std::pow(highGain, delayLengthSeconds) / normalization;
     feedbackGains[channel] = static_cast<float>(feedback);
+    highFeedbackGains[channel] = static_cast<float>(highFeedback);
   }
 }
 
-void FDNReverb::setParams(const Params& p)
+template<size_t Size>
+void FDNReverb<Size>::setParams(const Params& newParams)
 {
+  // Callers that don't set a separate time for the high band get the same decay in both bands:
+  auto p = newParams;
+  if (p.revTimeHigh <= 0.0f)
+    p.revTimeHigh = p.revTime;
+
+  if (juce::exactlyEqual(p.roomSize, params.roomSize) &&
+      juce::exactlyEqual(p.revTime, params.revTime) &&
+      juce::exactlyEqual(p.revTimeHigh, params.revTimeHigh) &&
+      juce::exactlyEqual(p.dryWet, params.dryWet))
+    return;
+
   params = p;
-  updateParameterSettings();
+  updateParameterSettings(true);
+}
+
+template<size_t Size>
+void FDNReverb<Size>::setProcessingMode(ProcessingMode mode)
+{
+  processingMode = mode;
 }
 
-void FDNReverb::setPreset(Preset p)
+template<size_t Size>
+void FDNReverb<Size>::setPreset(Preset p)
 {
   if (presets.contains(p))
     setParams(presets.at(p));
@@ -206,14 +417,61 @@ void FDNReverb::setPreset(Preset p)
     spdlog::warn("Reverb: invalid preset: {}", static_cast<int>(p));
 }
 
-void FDNReverb::setSampleRate(double newSampleRate)
+template<size_t Size>
+void FDNReverb<Size>::setSampleRate(double newSampleRate)
 {
+  if (juce::exactlyEqual(newSampleRate, sampleRate))
+    return;
+
   sampleRate = newSampleRate;
-  updateParameterSettings();
+
+  // The delay lengths grow with the reverberation time, so the longest delay of each line is the
+  // one for the longest reverberation time:
+  const auto longestIndices = generateIndices<Size>(static_cast<unsigned>(maxRevTime));
+  for (auto channel = 0U; channel < fdnSize; ++channel)
+  {
+    const auto longestPrime = primeNumbers[longestIndices[channel]];
+    maxDelayLengths[channel] = static_cast<size_t>(delaySeconds(longestPrime) * sampleRate) + 1;
+  }
+  delayLines.allocate(maxDelayLengths);
+  decayFilters.setCrossover(crossoverFrequency, sampleRate);
+  decayFilters.reset();
+
+  crossfadeLength = std::max(static_cast<size_t>(crossfadeTime * sampleRate), size_t{ 1 });
+  updateParameterSettings(false);
 }
 
-void FDNReverb::reset()
+template<size_t Size>
+void FDNReverb<Size>::reset()
 {
-  for (auto& buffer : delayBuffers)
-    buffer.clear();
+  delayLines.clear();
+  decayFilters.reset();
+  crossfadeSamplesLeft = 0;
+  quietSamples = 0;
+  idle = false;
 }
+
+template<size_t Size>
+auto FDNReverb<Size>::getTailLengthSeconds() const -> double
+{
+  // The time to decay from full scale to the silence threshold, at the slower of the two rates,
+  // after the first round trip through the longest delay line:
+  const auto revTime = std::clamp(std::max(params.revTime, params.revTimeHigh), 0.0f, maxRevTime);
+  const auto decayDb = -juce::Decibels::gainToDecibels(silenceThreshold);
+  const auto longestDelay = *std::max_element(delayLengths.begin(), delayLengths.end());
+
+  if (sampleRate <= 0.0 || revTime <= 0.0f)
+    return 0.0;
+  return static_cast<double>(longestDelay) / sampleRate + revTime * decayDb / 60.0;
+}
+
+template<size_t Size>
+auto FDNReverb<Size>::isIdle() const -> bool
+{
+  return idle;
+}
+
+template class fsh::fx::FDNReverb<16>;
+template class fsh::fx::FDNReverb<32>;
+template class fsh::fx::FDNReverb<64>;
+template class fsh::fx::FDNReverb<128>;
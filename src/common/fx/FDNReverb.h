@@ -20,71 +20,188 @@
 ***************************************************************************************************/
 
 #pragma once
-#include "IndexedVector.h"
+#include "DelayArena.h"
+#include "FastHadamard.h"
+#include "ShelfFilterBank.h"
+#include "SphericalHarmonics.h"
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <juce_dsp/juce_dsp.h>
 
 namespace fsh::fx
 {
+/// How FDNReverb::process() runs the feedback loop. Both give the same results.
+enum class ReverbProcessingMode
+{
+  Block,     ///< Chunks of up to the shortest delay length, vectorized across time (default)
+  PerSample, ///< One sample at a time, for verifying the block mode
+};
+
+/// Parameters for the FDN reverb algorithm. These are the same for all FDNReverb instantiations.
+struct ReverbParams
+{
+  float roomSize = 0.0f;    ///< Room size in meters
+  float revTime = 0.0f;     ///< Reverberation time below the crossover frequency in seconds
+  float revTimeHigh = 0.0f; ///< Reverberation time above the crossover (0: same as revTime)
+  float dryWet = 0.0f;      ///< Dry/wet mix [0, 1]
+};
+
+/// Presets for the FDN reverb algorithm.
+enum class ReverbPreset
+{
+  Off = 0, ///< No reverb
+  Earth,   ///< Small room with a short reverberation time
+  Metal,   ///< Medium-sized room with a medium reverberation time
+  Sky,     ///< Large room with a long reverberation time
+};
+
 /**
-Ambisonic FDN reverb algorithm.
+Ambisonic FDN reverb algorithm with `Size` delay lines.
 
 This class takes a JUCE AudioBuffer object in the ambisonic domain and applies the FDN reverb
 algorithm in-place using the process() method.
 
 Note that you must call setSampleRate() before calling process() for the first time.
 
+setSampleRate() allocates the delay lines for the longest possible delays, so changing the
+parameters never allocates, and is safe to do on the audio thread. The delay lengths are only
+recomputed when the parameters actually change. When they do, the delay lines are read at both the
+old and the new lengths for a short time, and crossfaded from one to the other.
+
+Each delay line has a first-order shelving filter, so that the reverb decays at a different rate
+below and above crossoverFrequency. The filters of all lines are processed together as one
+ShelfFilterBank.
+
+By default, the feedback loop runs in chunks of up to the shortest delay length: no sample in such a
+chunk depends on another sample of the same chunk, so each delay line can be read and written a
+whole chunk at a time, and the input is mixed in with loops that vectorize across time. Only the
+decay filters and the Hadamard mixing then run frame by frame, vectorized across the lines. The
+result is the same as running the loop one sample at a time, which is still available with
+ProcessingMode::PerSample.
+
+The delay lines are monitored for silence: once the tail has decayed below silenceThreshold, the
+lines are cleared and process() returns right away for as long as the input stays silent, so an
+idle reverb costs next to nothing. getTailLengthSeconds() gives the length of the tail for the
+current parameters, e.g. to report it to the host.
+
+The number of delay lines should be larger than the number of ambisonic channels, since only that
+many lines receive the input. More lines give a denser reverb, but cost more. Available for 16, 32,
+64 and 128 lines; see OrderReverb for the size that is used for each ambisonic order.
+
 > This class is a refactoring of code from the [IEM Plugin Suite](https://plugins.iem.at/).
 */
+template<size_t Size>
 class FDNReverb
 {
 public:
   /// The number of delay lines in the FDN.
-  static constexpr size_t fdnSize = 64;
+  static constexpr size_t fdnSize = Size;
+
+  /// The longest reverberation time in seconds. Longer times are clamped.
+  static constexpr float maxRevTime = 10.0f;
+
+  /// The duration of the crossfade between delay lengths in seconds.
+  static constexpr double crossfadeTime = 0.05;
+
+  /// The frequency between the low and the high reverberation time, in Hz.
+  static constexpr double crossoverFrequency = 4000.0;
+
+  /// The longest chunk of samples processed at once in ProcessingMode::Block.
+  static constexpr size_t maxChunkLength = 128;
+
+  /// Signals below this level (-100 dB) count as silence when tracking the reverb tail.
+  static constexpr float silenceThreshold = 1e-5f;
+
+  /// How process() runs the feedback loop.
+  using ProcessingMode = ReverbProcessingMode;
 
   /// Parameters for the FDN reverb algorithm.
-  struct Params
-  {
-    float roomSize = 0.0f; ///< Room size in meters
-    float revTime = 0.0f;  ///< Reverberation time in seconds
-    float dryWet = 0.0f;   ///< Dry/wet mix [0, 1]
-  };
+  using Params = ReverbParams;
 
   /// Presets for the FDN reverb algorithm.
-  enum class Preset
-  {
-    Off = 0, ///< No reverb
-    Earth,   ///< Small room with a short reverberation time
-    Metal,   ///< Medium-sized room with a medium reverberation time
-    Sky,     ///< Large room with a long reverberation time
-  };
+  using Preset = ReverbPreset;
 
   /// Default constructor.
   FDNReverb();
 
-  /// Set the parameters for the FDN reverb algorithm directly.
+  /// Set the parameters for the FDN reverb algorithm directly. Does nothing if the parameters are
+  /// unchanged.
   void setParams(const Params&);
 
   /// Set the parameters for the FDN reverb algorithm using a preset.
   void setPreset(Preset);
 
-  /// Set the sample rate. Must be called before calling process().
+  /// Set the sample rate. Must be called before calling process(). This allocates the delay lines,
+  /// so it should not be called on the audio thread.
   void setSampleRate(double);
 
+  /// Choose how process() runs the feedback loop.
+  void setProcessingMode(ProcessingMode);
+
   /// Apply the FDN reverb algorithm to the given ambisonic audio buffer.
   void process(juce::AudioBuffer<float>&);
 
   /// Clear the delay buffers.
   void reset();
 
+  /// The time it takes for the reverb tail to decay to silence once the input stops, in seconds.
+  auto getTailLengthSeconds() const -> double;
+
+  /// Returns true once the tail has decayed to silence. process() does nothing until the input is
+  /// no longer silent.
+  auto isIdle() const -> bool;
+
 private:
-  std::array<util::IndexedVector, fdnSize> delayBuffers;
+  // Each delay line is long enough for its longest delay, and is read at its delay length behind
+  // the shared write position:
+  util::DelayArena delayLines;
+  std::array<size_t, fdnSize> maxDelayLengths = {};
+
+  std::array<size_t, fdnSize> delayLengths = {};
+
+  // The gains of each line below and above the crossover frequency:
   std::array<float, fdnSize> feedbackGains = {};
+  std::array<float, fdnSize> highFeedbackGains = {};
+  util::ShelfFilterBank<fdnSize> decayFilters;
+
   std::array<float, fdnSize> transferVector = {};
-  std::vector<unsigned> primeNumbers;
+  util::FastHadamard<fdnSize> hadamard;
+
+  // The delay lengths and gains before the last parameter change, while crossfading:
+  std::array<size_t, fdnSize> previousDelayLengths = {};
+  std::array<float, fdnSize> previousFeedbackGains = {};
+  std::array<float, fdnSize> previousHighFeedbackGains = {};
+  size_t crossfadeLength = 0;
+  size_t crossfadeSamplesLeft = 0;
+
+  // A chunk of consecutive frames in ProcessingMode::Block, and one line of it:
+  alignas(64) std::array<std::array<float, fdnSize>, maxChunkLength> frames = {};
+  std::array<float, maxChunkLength> lineChunk = {};
+  std::array<float, maxChunkLength> previousChunk = {};
 
   Params params;
   double sampleRate = 0.0;
+  ProcessingMode processingMode = ProcessingMode::Block;
 
-  void updateParameterSettings();
+  // The number of samples in a row in which only silence was written to the delay lines:
+  size_t quietSamples = 0;
+  bool idle = false;
+
+  void processBlock(juce::AudioBuffer<float>&, size_t numChannelsToProcess);
+  void processPerSample(juce::AudioBuffer<float>&, size_t numChannelsToProcess);
+  void updateParameterSettings(bool crossfade);
 };
+
+/// The number of FDN delay lines for the given ambisonic order: the smallest available size that
+/// is larger than the number of channels, i.e. 16 lines for first order, and 64 for fifth order.
+constexpr auto fdnSizeForOrder(int order) -> size_t
+{
+  const auto numChannels = util::numChannelsForOrder(order);
+  return std::clamp(std::bit_ceil(numChannels + 1), size_t{ 16 }, size_t{ 128 });
+}
+
+/// The FDNReverb for the given ambisonic order, e.g. for use with util::OrderVariant.
+template<int Order>
+using OrderReverb = FDNReverb<fdnSizeForOrder(Order)>;
 } // namespace fsh::fx
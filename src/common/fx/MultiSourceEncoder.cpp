@@ -0,0 +1,214 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "MultiSourceEncoder.h"
+#include "WeightedSum.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <utility>
+
+using namespace fsh::fx;
+
+template<int Order>
+MultiSourceEncoder<Order>::MultiSourceEncoder(std::shared_ptr<util::WorkerPool> pool)
+  : _pool(std::move(pool))
+{
+  for (auto source = 0U; source < _sources.size(); ++source)
+    updateTarget(source);
+  reset();
+}
+
+template<int Order>
+void MultiSourceEncoder<Order>::setParams(const Params& params)
+{
+  if (juce::exactlyEqual(params.order.get(), _params.order.get()))
+    return;
+
+  _params = params;
+  for (auto source = 0U; source < _sources.size(); ++source)
+    updateTarget(source);
+}
+
+template<int Order>
+void MultiSourceEncoder<Order>::setSourceParams(size_t source, const SourceParams& params)
+{
+  if (source >= _sources.size())
+    return spdlog::error("MultiSourceEncoder: source {} out of range ({} sources)",
+                         source,
+                         _sources.size());
+
+  const auto& old = _sources[source];
+  if (juce::exactlyEqual(params.direction.azimuth, old.direction.azimuth) &&
+      juce::exactlyEqual(params.direction.elevation, old.direction.elevation) &&
+      juce::exactlyEqual(params.gain, old.gain))
+    return;
+
+  _sources[source] = params;
+  updateTarget(source);
+}
+
+template<int Order>
+void MultiSourceEncoder<Order>::reset()
+{
+  _current = _target;
+  _changed = false;
+}
+
+template<int Order>
+void MultiSourceEncoder<Order>::updateTarget(size_t source)
+{
+  // Same order fading as AmbisonicEncoder:
+  const auto wholeOrder = static_cast<size_t>(_params.order.get());
+  const auto fadeGain = _params.order.get() - static_cast<float>(wholeOrder);
+
+  const auto fullGainChannels = (wholeOrder + 1) * (wholeOrder + 1);
+  const auto reducedGainChannels = (wholeOrder + 2) * (wholeOrder + 2);
+
+  const auto coefficients = util::harmonics(_sources[source].direction);
+  const auto gain = _sources[source].gain;
+
+  for (auto ch = 0U; ch < numChannels; ++ch)
+  {
+    if (ch < fullGainChannels)
+      _target[ch][source] = gain * coefficients[ch];
+    else if (ch < reducedGainChannels)
+      _target[ch][source] = gain * fadeGain * coefficients[ch];
+    else
+      _target[ch][source] = 0.0f;
+  }
+
+  _changed = true;
+}
+
+template<int Order>
+void MultiSourceEncoder<Order>::process(const juce::AudioBuffer<float>& input,
+                                        juce::AudioBuffer<float>& output)
+{
+  const auto numSamples = output.getNumSamples();
+  auto numSources = static_cast<size_t>(input.getNumChannels());
+
+  if (input.getNumSamples() < numSamples)
+    return spdlog::critical("MultiSourceEncoder: input has {} samples, output has {}",
+                            input.getNumSamples(),
+                            numSamples);
+
+  if (numSources > static_cast<size_t>(maxNumSources))
+  {
+    spdlog::warn("MultiSourceEncoder: got {} inputs, only the first {} are encoded",
+                 numSources,
+                 maxNumSources);
+    numSources = maxNumSources;
+  }
+
+  if (static_cast<size_t>(output.getNumChannels()) < numChannels)
+    spdlog::warn("MultiSourceEncoder: encoding {} channels, but only {} channels are available",
+                 numChannels,
+                 output.getNumChannels());
+
+  // The ramp from the current to the target coefficients is done as a second matrix
+  // multiplication with their difference, scaled by the position in the block:
+  const auto ramp = _changed;
+  if (ramp)
+    for (auto row = 0U; row < numChannels; ++row)
+      for (auto source = 0U; source < numSources; ++source)
+        _difference[row][source] = _target[row][source] - _current[row][source];
+
+  const auto task = [&](size_t t) { processTile(t, input, output, numSources, numSamples, ramp); };
+  if (numSources >= minSourcesForThreads && _pool->numThreads() > 0)
+    _pool->run(numTiles, task);
+  else
+    for (auto tile = 0U; tile < numTiles; ++tile)
+      processTile(tile, input, output, numSources, numSamples, ramp);
+
+  if (ramp)
+    reset();
+}
+
+template<int Order>
+void MultiSourceEncoder<Order>::processTile(size_t tile,
+                                            const juce::AudioBuffer<float>& input,
+                                            juce::AudioBuffer<float>& output,
+                                            size_t numSources,
+                                            int numSamples,
+                                            bool ramp)
+{
+  const auto firstChannel = tile * channelsPerTile;
+  const auto numOutputChannels =
+    std::min(numChannels, static_cast<size_t>(output.getNumChannels()));
+
+  if (firstChannel >= numOutputChannels)
+    return;
+
+  // One tile of the output (channelsPerTile x samplesPerTile) is accumulated over all sources,
+  // while it stays in the cache. The matrices have unused rows at the end, so the last tile can
+  // always read channelsPerTile rows:
+  auto tileOutput = std::array<std::array<float, samplesPerTile>, channelsPerTile>{};
+  auto tileRamp = std::array<std::array<float, samplesPerTile>, channelsPerTile>{};
+  auto rampPosition = std::array<float, samplesPerTile>{};
+  auto samples = std::array<const float*, maxNumSources>{};
+
+  for (auto start = 0; start < numSamples; start += samplesPerTile)
+  {
+    const auto length = static_cast<size_t>(std::min(samplesPerTile, numSamples - start));
+
+    for (auto& row : tileOutput)
+      std::fill_n(row.begin(), length, 0.0f);
+    if (ramp)
+      for (auto& row : tileRamp)
+        std::fill_n(row.begin(), length, 0.0f);
+
+    for (auto source = 0U; source < numSources; ++source)
+      samples[source] = input.getReadPointer(static_cast<int>(source), start);
+
+    for (auto c = 0U; c < channelsPerTile; ++c)
+    {
+      const auto row = firstChannel + c;
+      util::addWeightedSum(
+        tileOutput[c].data(), _current[row].data(), samples.data(), numSources, length);
+      if (ramp)
+        util::addWeightedSum(
+          tileRamp[c].data(), _difference[row].data(), samples.data(), numSources, length);
+    }
+
+    if (ramp)
+      for (auto i = 0UL; i < length; ++i)
+        rampPosition[i] = static_cast<float>(static_cast<size_t>(start) + i + 1) /
+                          static_cast<float>(numSamples);
+
+    for (auto c = 0U; c < channelsPerTile && firstChannel + c < numOutputChannels; ++c)
+    {
+      auto* const out = output.getWritePointer(static_cast<int>(firstChannel + c), start);
+
+      if (ramp)
+        for (auto i = 0UL; i < length; ++i)
+          out[i] = tileOutput[c][i] + rampPosition[i] * tileRamp[c][i];
+      else
+        std::copy_n(tileOutput[c].cbegin(), length, out);
+    }
+  }
+}
+
+static_assert(fsh::util::maxAmbiOrder == 5, "update the explicit instantiations below");
+template class fsh::fx::MultiSourceEncoder<1>;
+template class fsh::fx::MultiSourceEncoder<2>;
+template class fsh::fx::MultiSourceEncoder<3>;
+template class fsh::fx::MultiSourceEncoder<4>;
+template class fsh::fx::MultiSourceEncoder<5>;
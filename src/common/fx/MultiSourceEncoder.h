@@ -0,0 +1,127 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "BoundedValue.h"
+#include "SphericalHarmonics.h"
+#include "SphericalVector.h"
+#include "WorkerPool.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <memory>
+
+namespace fsh::fx
+{
+/**
+Encodes many mono sources into Ambisonics at once.
+
+This does the same as one AmbisonicEncoder per source, but treats all sources together as a matrix
+multiplication: the output block (channels x samples) is the coefficient matrix (channels x
+sources) times the input block (sources x samples). The multiplication is done in small tiles of
+channels and samples that stay in the cache while all sources are accumulated into them.
+
+When the coefficients change, they are ramped linearly from the old to the new values over the
+next block, which costs a second matrix multiplication for that block. Static sources only cost
+one.
+
+For many sources, the output channels are split into groups that are computed in parallel on a
+util::WorkerPool, by default the one shared by the whole process. That pool is started if no one
+else is using it, so the encoder should not be created on the audio thread.
+
+**Before using:** set the direction of each source with setSourceParams().
+
+**To use:** call process() once per block, with one input channel per source.
+*/
+template<int Order = util::maxAmbiOrder>
+class MultiSourceEncoder
+{
+public:
+  /// Maximum order, i.e. the order of the output channels.
+  static constexpr auto maxOrder = Order;
+
+  /// Maximum number of sources.
+  static constexpr auto maxNumSources = 256;
+
+  /// Number of output channels.
+  static constexpr auto numChannels = util::numChannelsForOrder(Order);
+
+  /// Parameters for all sources.
+  struct Params
+  {
+    util::BoundedFloat<0, Order> order = Order; ///< order to encode to (same as AmbisonicEncoder)
+  };
+
+  /// Parameters for a single source.
+  struct SourceParams
+  {
+    util::SphericalVector direction; ///< direction to encode to
+    float gain = 1.0f;               ///< linear gain
+  };
+
+  /// Create an encoder that runs on the given worker pool, in addition to the thread that calls
+  /// process().
+  explicit MultiSourceEncoder(std::shared_ptr<util::WorkerPool> = util::WorkerPool::shared());
+
+  /// Set the parameters for all sources.
+  void setParams(const Params&);
+
+  /// Set the parameters for the given source.
+  void setSourceParams(size_t source, const SourceParams&);
+
+  /// Encode one block. Each channel of `input` is a source, up to maxNumSources. The first
+  /// numChannels channels of `output` are overwritten with the encoded signal. `input` and
+  /// `output` must not be the same buffer.
+  void process(const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output);
+
+  /// Jump to the current parameters, without ramping.
+  void reset();
+
+private:
+  // Channels per task, and per tile of the matrix multiplication:
+  static constexpr size_t channelsPerTile = 4;
+  static constexpr auto numTiles = (numChannels + channelsPerTile - 1) / channelsPerTile;
+
+  // Samples per tile:
+  static constexpr auto samplesPerTile = 64;
+
+  // Below this number of sources, the matrix is small enough to not bother with threads:
+  static constexpr size_t minSourcesForThreads = 16;
+
+  using Matrix = std::array<std::array<float, maxNumSources>, numTiles * channelsPerTile>;
+
+  void updateTarget(size_t source);
+  void processTile(size_t tile,
+                   const juce::AudioBuffer<float>& input,
+                   juce::AudioBuffer<float>& output,
+                   size_t numSources,
+                   int numSamples,
+                   bool ramp);
+
+  Params _params;
+  std::array<SourceParams, maxNumSources> _sources;
+
+  Matrix _current = {};
+  Matrix _target = {};
+  Matrix _difference = {};
+  bool _changed = false;
+
+  std::shared_ptr<util::WorkerPool> _pool;
+};
+} // namespace fsh::fx
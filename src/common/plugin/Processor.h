@@ -20,6 +20,7 @@
 ***************************************************************************************************/
 
 #pragma once
+#include <atomic>
 #include <juce_audio_processors/juce_audio_processors.h>
 
 // The following macros are here just to appease the compiler. When including this file in a plugin,
@@ -155,8 +156,9 @@ public:
   /// Get the plugin name (as specified in the JUCE project settings)
   const juce::String getName() const override { return _name; }
 
-  /// Return the plugin's audio tail length. The default implementation returns 0.0.
-  double getTailLengthSeconds() const override { return 0.0; }
+  /// Return the plugin's audio tail length, as set with setTailLengthSeconds(). This is 0.0 unless
+  /// the plugin sets it.
+  double getTailLengthSeconds() const override { return _tailLengthSeconds; }
 
   /// Returns whether the plugin has an editor. (It does, by default.)
   bool hasEditor() const override { return true; }
@@ -223,6 +225,10 @@ protected:
   /// is passed as a template parameter to PluginBase.
   StateManager _params;
 
+  /// Set the audio tail length reported to the host, e.g. the decay time of a reverb. This is safe
+  /// to call from processBlock().
+  void setTailLengthSeconds(double seconds) { _tailLengthSeconds = seconds; }
+
 private:
   /// Create the plugin's editor. The default implementation creates a GenericAudioProcessorEditor,
   /// which will display an unstyled list of your plugin's parameters. This is good enough to start,
@@ -241,6 +247,7 @@ private:
   inline static const auto _producesMidi = bool{ JucePlugin_ProducesMidiOutput };
   inline static const auto _isMidiEffect = bool{ JucePlugin_IsMidiEffect };
   Config _conf;
+  std::atomic<double> _tailLengthSeconds = 0.0;
   juce::ScopedNoDenormals _disableDenormals;
 };
 } // namespace fsh::plugin
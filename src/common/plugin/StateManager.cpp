@@ -49,3 +49,13 @@ auto StateManager::getReferenceToBaseClass() -> juce::AudioProcessorValueTreeSta
 {
   return *this;
 }
+
+auto StateManager::getStateProperty(const juce::Identifier& name) const -> juce::var
+{
+  return state.getProperty(name);
+}
+
+void StateManager::setStateProperty(const juce::Identifier& name, const juce::var& value)
+{
+  state.setProperty(name, value, nullptr);
+}
@@ -64,6 +64,14 @@ public:
   auto getReferenceToBaseClass() -> juce::AudioProcessorValueTreeState&;
 
 protected:
+  /// Get a property that is saved and recalled with the plugin state, but isn't a parameter the DAW
+  /// can automate, e.g. a random seed. Returns an empty juce::var if the property isn't set. This
+  /// is not thread-safe, so it should not be called on the audio thread.
+  auto getStateProperty(const juce::Identifier&) const -> juce::var;
+
+  /// Set a property that is saved and recalled with the plugin state, see getStateProperty().
+  void setStateProperty(const juce::Identifier&, const juce::var&);
+
   /// Get a parameter by its ID string. This is a wrapper around
   /// juce::AudioProcessorValueTreeState::getRawParameterValue(), but with a nullptr check. If you
   /// try to get a parameter that doesn't exist, this function will fail gracefully by returning
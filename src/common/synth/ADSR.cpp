@@ -82,6 +82,25 @@ auto ADSR::getNextValue() -> double
   return 0.0f;
 }
 
+auto ADSR::getCurrentValue() const -> double
+{
+  switch (_phase)
+  {
+    using enum Phase;
+    case Sustain:
+      return _params.sustain;
+    case Idle:
+      return 0.0;
+    case Attack:
+    case Decay:
+    case Release:
+      return _env.getCurrentValue();
+  }
+
+  spdlog::error("ADSR: invalid phase");
+  return 0.0;
+}
+
 void ADSR::noteOn()
 {
   _phase = Phase::Attack;
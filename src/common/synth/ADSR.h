@@ -60,6 +60,9 @@ public:
   /// Compute the envelope's next value
   auto getNextValue() -> double;
 
+  /// Returns the envelope's current value, without advancing it
+  auto getCurrentValue() const -> double;
+
   /// Start the envelope's attack phase
   void noteOn();
 
@@ -0,0 +1,77 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "NoiseGenerator.h"
+
+using namespace fsh::synth;
+
+namespace
+{
+// SplitMix32-style hash, which turns similar seeds into unrelated states:
+auto scramble(uint32_t x) -> uint32_t
+{
+  x += 0x9e3779b9u;
+  x = (x ^ (x >> 16)) * 0x85ebca6bu;
+  x = (x ^ (x >> 13)) * 0xc2b2ae35u;
+  return x ^ (x >> 16);
+}
+
+// Advance the xorshift32 state, and scale it from full-range signed integers to [-1, 1]:
+auto step(uint32_t& state) -> float
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return static_cast<float>(static_cast<int32_t>(state)) * (1.0f / 2'147'483'648.0f);
+}
+} // namespace
+
+NoiseGenerator::NoiseGenerator(uint32_t seed)
+{
+  setSeed(seed);
+}
+
+void NoiseGenerator::setSeed(uint32_t seed)
+{
+  for (auto lane = 0UL; lane < numLanes; ++lane)
+  {
+    // xorshift gets stuck at 0, so every lane needs at least one bit set:
+    const auto state = scramble(seed * numLanes + static_cast<uint32_t>(lane));
+    _state[lane] = state != 0 ? state : 1;
+  }
+
+  _blockPosition = _block.size();
+}
+
+void NoiseGenerator::fill(float* out, size_t numSamples)
+{
+  auto state = _state;
+  auto start = 0UL;
+
+  for (; start + numLanes <= numSamples; start += numLanes)
+    for (auto lane = 0UL; lane < numLanes; ++lane)
+      out[start + lane] = step(state[lane]);
+
+  for (auto lane = 0UL; start + lane < numSamples; ++lane)
+    out[start + lane] = step(state[lane]);
+
+  _state = state;
+}
@@ -0,0 +1,70 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fsh::synth
+{
+/**
+White noise in [-1, 1], from a seedable pseudo-random generator without any shared state.
+
+The generator runs numLanes independent xorshift32 generators in lockstep, so filling a block with
+fill() compiles to SIMD instructions. nextSample() hands out the samples of an internal block, and
+refills it when it runs out.
+
+The same seed always gives the same sequence, e.g. for deterministic offline renders. Generators
+that run at the same time should use different seeds, or they will produce the same noise.
+*/
+class NoiseGenerator
+{
+public:
+  /// Create a generator with the given seed
+  explicit NoiseGenerator(uint32_t seed = 0);
+
+  /// Restart the sequence with the given seed
+  void setSeed(uint32_t seed);
+
+  /// Compute the next sample
+  auto nextSample() -> float
+  {
+    if (_blockPosition == _block.size())
+    {
+      fill(_block.data(), _block.size());
+      _blockPosition = 0;
+    }
+    return _block[_blockPosition++];
+  }
+
+  /// Fill the given buffer with the next numSamples samples. This bypasses the samples still
+  /// buffered for nextSample().
+  void fill(float* out, size_t numSamples);
+
+private:
+  static constexpr auto numLanes = 8U;
+
+  std::array<uint32_t, numLanes> _state;
+  std::array<float, 64> _block;
+  size_t _blockPosition;
+};
+} // namespace fsh::synth
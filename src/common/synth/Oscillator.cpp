@@ -21,8 +21,12 @@
 
 #define _USE_MATH_DEFINES
 #include "Oscillator.h"
+#include "WavetableBank.h"
 #include "spdlog/spdlog.h"
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <utility>
 
 using namespace fsh::synth;
 
@@ -38,55 +42,138 @@ Some reference values:
 - 40th sawtooth partial is at 1/250 amplitude (= -48 dB)
 - 40th triangle partial is at 1/250^2 amplitude (= -96 dB)
 */
-const auto overtoneLimit = 100;
+constexpr auto overtoneLimit = 100;
 
 double sine(double phase)
 {
   return std::sin(2.0 * M_PI * phase);
 }
 
-double noise()
+/*
+The additive waveforms are sums of `amplitude[k] * sin(2 pi k phase)`. Instead of calling `std::sin`
+for each harmonic, the harmonics are generated by rotating complex phasors: with
+`z = exp(i 2 pi phase)`, harmonic k is the imaginary part of `z^k`. The first numLanes powers of z
+are computed directly, and each further group of numLanes harmonics is the previous group times
+`z^numLanes`. So each sample only needs one sine/cosine pair, and the float rotations and
+multiply-adds are independent across lanes, so they can run in SIMD registers. The rounding
+errors of the rotations add up to less than 1e-5 compared to calling `std::sin` for every harmonic.
+*/
+constexpr auto numLanes = 8;
+constexpr auto numGroups = (overtoneLimit + numLanes - 1) / numLanes;
+
+// Amplitude of each harmonic, starting with the fundamental at index 0, including the factor of
+// 2 / pi that all additive waveforms share:
+using Amplitudes = std::array<float, numGroups * numLanes>;
+
+template<typename Amplitude>
+constexpr auto makeAmplitudes(Amplitude amplitude) -> Amplitudes
 {
-  return static_cast<double>(std::rand()) / static_cast<double>(RAND_MAX);
+  auto amplitudes = Amplitudes{};
+  for (auto k = 1; k <= overtoneLimit; ++k)
+    amplitudes[static_cast<size_t>(k - 1)] = static_cast<float>((2.0 / M_PI) * amplitude(k));
+  return amplitudes;
 }
 
-double saw(double phase, double deltaPhase)
+// "Good enough" saw, every harmonic has positive sign:
+constexpr auto sawAmplitudes = makeAmplitudes([](int k) { return 1.0 / k; });
+
+// "Technically correct" saw, every other harmonic has negative sign:
+constexpr auto truesawAmplitudes =
+  makeAmplitudes([](int k) { return (k % 2 == 1 ? 1.0 : -1.0) / k; });
+
+// "Good enough" triangle, every harmonic has positive sign:
+constexpr auto triangleAmplitudes =
+  makeAmplitudes([](int k) { return k % 2 == 1 ? 1.0 / (k * k) : 0.0; });
+
+// "Technically correct" triangle, every other harmonic has negative sign:
+constexpr auto truetriangleAmplitudes = makeAmplitudes(
+  [](int k) { return k % 2 == 0 ? 0.0 : (k % 4 == 1 ? 1.0 : -1.0) / (k * k); });
+
+constexpr auto squareAmplitudes =
+  makeAmplitudes([](int k) { return k % 2 == 1 ? 1.0 / k : 0.0; });
+
+// Returns the highest harmonic `first + n * step` below Nyquist and within the overtone limit, or
+// 0 if there is none:
+int highestHarmonic(double deltaPhase, int first, int step)
 {
-  if (deltaPhase < 0.0001)
+  const auto nyquist = 0.5;
+  const auto isAllowed = [&](int k) { return (k * deltaPhase < nyquist) && (k <= overtoneLimit); };
+
+  if (!isAllowed(first))
+    return 0;
+
+  // Estimate, then correct the rounding errors of the estimate:
+  const auto limit = std::min(nyquist / deltaPhase, static_cast<double>(overtoneLimit + 1));
+  auto k = first + step * static_cast<int>((limit - first) / step);
+  while (k > first && !isAllowed(k))
+    k -= step;
+  while (isAllowed(k + step))
+    k += step;
+  return k;
+}
+
+double sumOfSines(double phase, const Amplitudes& amplitudes, int numHarmonics)
+{
+  // The phasors of the first group of harmonics, and the rotation from one group to the next:
+  auto re = std::array<float, numLanes>{};
+  auto im = std::array<float, numLanes>{};
+  const auto zRe = std::cos(2.0 * M_PI * phase);
+  const auto zIm = std::sin(2.0 * M_PI * phase);
+  auto zkRe = zRe;
+  auto zkIm = zIm;
+  for (auto lane = 0UL; lane < numLanes; ++lane)
   {
-    spdlog::warn("oscillator called with zero frequency");
-    return 0.0;
+    re[lane] = static_cast<float>(zkRe);
+    im[lane] = static_cast<float>(zkIm);
+    const auto nextRe = zkRe * zRe - zkIm * zIm;
+    zkIm = zkRe * zIm + zkIm * zRe;
+    zkRe = nextRe;
   }
+  const auto rotationRe = re[numLanes - 1];
+  const auto rotationIm = im[numLanes - 1];
 
-  const auto nyquist = 0.5;
-  auto out = 0.0;
+  auto sums = std::array<float, numLanes>{};
+  const auto numGroupsUsed = static_cast<size_t>((numHarmonics + numLanes - 1) / numLanes);
+  for (auto group = 0UL; group < numGroupsUsed; ++group)
+    for (auto lane = 0UL; lane < numLanes; ++lane)
+    {
+      const auto index = group * numLanes + lane;
+      const auto isUsed = index < static_cast<size_t>(numHarmonics);
+      sums[lane] += (isUsed ? amplitudes[index] : 0.0f) * im[lane];
 
-  // "Good enough" saw, every harmonic has positive sign:
-  for (auto k = 1; (k * deltaPhase < nyquist) && (k <= overtoneLimit); ++k)
-    out += std::sin(2.0 * M_PI * k * phase) / k;
+      const auto nextRe = re[lane] * rotationRe - im[lane] * rotationIm;
+      im[lane] = re[lane] * rotationIm + im[lane] * rotationRe;
+      re[lane] = nextRe;
+    }
 
-  return (2.0 / M_PI) * out;
+  auto out = 0.0;
+  for (const auto sum : sums)
+    out += static_cast<double>(sum);
+  return out;
 }
 
-double truesaw(double phase, double deltaPhase)
+double saw(double phase, double deltaPhase)
 {
   if (deltaPhase < 0.0001)
   {
-    spdlog::warn("oscillator called with zero or negative frequency");
+    spdlog::warn("oscillator called with zero frequency");
     return 0.0;
   }
 
-  const auto nyquist = 0.5;
-  auto out = 0.0;
+  return sumOfSines(phase, sawAmplitudes, highestHarmonic(deltaPhase, 1, 1));
+}
 
-  // "Technically correct" saw, every other harmonic has negative sign:
-  for (auto k = 1; (k * deltaPhase < nyquist) && (k <= overtoneLimit); k += 2)
+double truesaw(double phase, double deltaPhase)
+{
+  if (deltaPhase < 0.0001)
   {
-    out += std::sin(2.0 * M_PI * (k + 0) * phase) / (k + 0);
-    out -= std::sin(2.0 * M_PI * (k + 1) * phase) / (k + 1);
+    spdlog::warn("oscillator called with zero or negative frequency");
+    return 0.0;
   }
 
-  return (2.0 / M_PI) * out;
+  // The harmonics come in pairs, and the second one of the last pair may be above Nyquist:
+  const auto highest = highestHarmonic(deltaPhase, 1, 2);
+  return sumOfSines(phase, truesawAmplitudes, highest > 0 ? highest + 1 : 0);
 }
 
 double triangle(double phase, double deltaPhase)
@@ -97,14 +184,7 @@ double triangle(double phase, double deltaPhase)
     return 0.0;
   }
 
-  const auto nyquist = 0.5;
-  auto out = 0.0;
-
-  // "Good enough" triangle, every harmonic has positive sign:
-  for (auto k = 1; (k * deltaPhase < nyquist) && (k <= overtoneLimit); k += 2)
-    out += std::sin(2.0 * M_PI * k * phase) / (k * k);
-
-  return (2.0 / M_PI) * out;
+  return sumOfSines(phase, triangleAmplitudes, highestHarmonic(deltaPhase, 1, 2));
 }
 
 double truetriangle(double phase, double deltaPhase)
@@ -115,17 +195,9 @@ double truetriangle(double phase, double deltaPhase)
     return 0.0;
   }
 
-  const auto nyquist = 0.5;
-  auto out = 0.0;
-
-  // "Technically correct" triangle, every other harmonic has negative sign:
-  for (auto k = 1; (k * deltaPhase < nyquist) && (k <= overtoneLimit); k += 4)
-  {
-    out += std::sin(2.0 * M_PI * (k + 0) * phase) / ((k + 0) * (k + 0));
-    out -= std::sin(2.0 * M_PI * (k + 2) * phase) / ((k + 2) * (k + 2));
-  }
-
-  return (2.0 / M_PI) * out;
+  // The harmonics come in pairs, and the second one of the last pair may be above Nyquist:
+  const auto highest = highestHarmonic(deltaPhase, 1, 4);
+  return sumOfSines(phase, truetriangleAmplitudes, highest > 0 ? highest + 2 : 0);
 }
 
 double square(double phase, double deltaPhase)
@@ -136,13 +208,88 @@ double square(double phase, double deltaPhase)
     return 0.0;
   }
 
-  const auto nyquist = 0.5;
-  auto out = 0.0;
+  return sumOfSines(phase, squareAmplitudes, highestHarmonic(deltaPhase, 1, 2));
+}
 
-  for (auto k = 1; (k * deltaPhase < nyquist) && (k <= overtoneLimit); k += 2)
-    out += std::sin(2.0 * M_PI * k * phase) / k;
+/*
+PolyBLEP/PolyBLAMP waveforms: the naive waveform, with a polynomial correction in the two samples
+around each discontinuity. This removes most of the aliasing for a handful of operations per
+sample, no matter the frequency. The waveforms match the additive ones above, except for the
+highest harmonics, which are slightly attenuated.
+*/
 
-  return (2.0 / M_PI) * out;
+// Residual of a band-limited step of height -2 at phase 0, for t in [0, 1) phase since the step:
+double polyBlep(double t, double deltaPhase)
+{
+  if (t < deltaPhase)
+  {
+    t /= deltaPhase;
+    return t + t - t * t - 1.0;
+  }
+  if (t > 1.0 - deltaPhase)
+  {
+    t = (t - 1.0) / deltaPhase;
+    return t * t + t + t + 1.0;
+  }
+  return 0.0;
+}
+
+// Residual of a band-limited ramp, i.e. the integral of polyBlep(), for a change in slope of 1 per
+// sample at phase 0:
+double polyBlamp(double t, double deltaPhase)
+{
+  if (t < deltaPhase)
+  {
+    t = t / deltaPhase - 1.0;
+    return -t * t * t / 6.0;
+  }
+  if (t > 1.0 - deltaPhase)
+  {
+    t = (t - 1.0) / deltaPhase + 1.0;
+    return t * t * t / 6.0;
+  }
+  return 0.0;
+}
+
+double wrap(double phase)
+{
+  return phase - std::floor(phase);
+}
+
+double blepSaw(double phase, double deltaPhase)
+{
+  // Falls from 1 to -1, and jumps up by 2 at phase 0:
+  return 1.0 - 2.0 * phase + polyBlep(phase, deltaPhase);
+}
+
+double blepTruesaw(double phase, double deltaPhase)
+{
+  // Rises from -1 to 1, and jumps down by 2 at phase 0.5:
+  const auto t = wrap(phase + 0.5);
+  return 2.0 * t - 1.0 - polyBlep(t, deltaPhase);
+}
+
+double blepSquare(double phase, double deltaPhase)
+{
+  // Jumps up by 1 at phase 0, and down by 1 at phase 0.5:
+  const auto naive = phase < 0.5 ? 0.5 : -0.5;
+  return naive + 0.5 * polyBlep(phase, deltaPhase) - 0.5 * polyBlep(wrap(phase + 0.5), deltaPhase);
+}
+
+double blepTriangle(double phase, double deltaPhase)
+{
+  // Rises from 0 to its peak at phase 0.25, falls to minus its peak at phase 0.75, and rises back
+  // to 0. This is the true triangle, but the triangle with all positive harmonics has the same
+  // spectrum, only with different phases, so it sounds the same:
+  const auto peak = M_PI / 4.0;
+  const auto naive = peak * (phase < 0.25 ? 4.0 * phase
+                             : phase < 0.75 ? 2.0 - 4.0 * phase
+                                            : 4.0 * phase - 4.0);
+
+  // The slope changes by 8 * peak per cycle at each corner:
+  const auto slopeChange = 8.0 * peak * deltaPhase;
+  return naive - slopeChange * polyBlamp(wrap(phase - 0.25), deltaPhase) +
+         slopeChange * polyBlamp(wrap(phase - 0.75), deltaPhase);
 }
 } // namespace
 
@@ -153,9 +300,33 @@ void Oscillator::reset()
 
 auto Oscillator::nextSample() -> float
 {
+  const auto useWavetables = _params.mode == Mode::Wavetable && _wavetables != nullptr &&
+                            WavetableBank::hasTables(_params.waveform);
+
   const auto out = [&]()
   {
     using enum Waveform;
+    if (useWavetables)
+      return static_cast<double>(_wavetables->sample(
+        _params.waveform, { .index = _wavetableLevel, .fade = _wavetableFade }, _phase));
+
+    if (_params.mode == Mode::PolyBLEP)
+      switch (_params.waveform)
+      {
+        case Saw:
+          return blepSaw(_phase, _deltaPhase);
+        case TrueSaw:
+          return blepTruesaw(_phase, _deltaPhase);
+        case Triangle:
+        case TrueTriangle:
+          return blepTriangle(_phase, _deltaPhase);
+        case Square:
+          return blepSquare(_phase, _deltaPhase);
+        case Sine:
+        case Noise:
+          break;
+      }
+
     switch (_params.waveform)
     {
       default:
@@ -174,7 +345,7 @@ auto Oscillator::nextSample() -> float
       case Square:
         return square(_phase, _deltaPhase);
       case Noise:
-        return noise();
+        return static_cast<double>(_noise.nextSample());
     }
   }();
 
@@ -194,7 +365,21 @@ void Oscillator::setParams(const Params& params)
   _params = params;
 }
 
+void Oscillator::setSeed(uint32_t seed)
+{
+  _noise.setSeed(seed);
+}
+
+void Oscillator::setWavetables(std::shared_ptr<const WavetableBank> wavetables)
+{
+  _wavetables = std::move(wavetables);
+}
+
 void Oscillator::setFrequency(double freq)
 {
   _deltaPhase = (freq * _params.detune) / _sampleRate;
+
+  const auto level = WavetableBank::levelFor(_deltaPhase);
+  _wavetableLevel = level.index;
+  _wavetableFade = level.fade;
 }
@@ -20,9 +20,15 @@
 ***************************************************************************************************/
 
 #pragma once
+#include "NoiseGenerator.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 
 namespace fsh::synth
 {
+class WavetableBank;
+
 /**
 Represents a single band-limited oscillator with multiple waveforms.
 
@@ -35,6 +41,18 @@ Set the sample rate using setSampleRate() and set the oscillator's parameters us
 - Call setFrequency() to set the oscillator's frequency.
 - Call nextSample() to compute the oscillator's next sample.
 
+## Wavetables
+
+By default, the harmonic waveforms are read from the band-limited tables of a WavetableBank, which
+is much cheaper than computing them additively. Set the bank using setWavetables(), which is
+usually shared between all oscillators. Without a bank, or with Mode::Additive, the waveforms are
+computed additively. The harmonics are generated by rotating complex phasors, so each sample only
+needs one sine/cosine pair, plus a multiply-add per harmonic.
+
+Mode::PolyBLEP is cheaper still, and its cost doesn't depend on the frequency: it computes the naive
+waveforms, and smooths each jump (PolyBLEP) and corner (PolyBLAMP) with a short polynomial. It
+aliases a little more than the other modes, mostly at high frequencies.
+
 > This class is loosely based on code from the [JX10
 > synthesizer](https://github.com/hollance/synth-plugin-book) by Matthijs Hollemans.
 */
@@ -51,16 +69,25 @@ public:
 
     Sine,     ///< Sine wave
     Saw,      ///< Sawtooth wave with all positive positive harmonics
-    Noise,    ///< White noise
+    Noise,    ///< White noise in [-1, 1]
     Triangle, ///< Triangle wave with all positive harmonics≤
   };
 
+  /// How the harmonic waveforms are computed. Sine and noise are the same in both modes.
+  enum class Mode
+  {
+    Wavetable, ///< Read from band-limited tables, see WavetableBank (default)
+    Additive,  ///< Sum the harmonics below Nyquist, for reference
+    PolyBLEP,  ///< Naive waveforms with polynomial corrections around the corners and jumps
+  };
+
   /// Oscillator parameters
   struct Params
   {
-    double detune;     ///< Factor that will be multiplied with the oscillator's frequency
-    double amplitude;  ///< Amplitude multiplier
-    Waveform waveform; ///< Waveform
+    double detune;               ///< Factor that will be multiplied with the oscillator's frequency
+    double amplitude;            ///< Amplitude multiplier
+    Waveform waveform;           ///< Waveform
+    Mode mode = Mode::Wavetable; ///< How the harmonic waveforms are computed
   };
 
   /// Set the sample rate in Hz
@@ -72,6 +99,12 @@ public:
   /// Set the oscillator's parameters
   void setParams(const Params&);
 
+  /// Seed the generator for Waveform::Noise, see NoiseGenerator
+  void setSeed(uint32_t seed);
+
+  /// Use the given tables for Mode::Wavetable, see WavetableBank::get()
+  void setWavetables(std::shared_ptr<const WavetableBank>);
+
   /// Compute the oscillator's next sample
   auto nextSample() -> float;
 
@@ -84,5 +117,12 @@ private:
   double _phase;
   double _deltaPhase;
   double _sampleRate;
+
+  // The bank, and the mip levels for the current frequency, see WavetableBank::levelFor():
+  std::shared_ptr<const WavetableBank> _wavetables;
+  size_t _wavetableLevel = 0;
+  float _wavetableFade = 0.0f;
+
+  NoiseGenerator _noise;
 };
 } // namespace fsh::synth
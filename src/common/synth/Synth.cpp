@@ -20,39 +20,76 @@
 ***************************************************************************************************/
 
 #include "Synth.h"
+#include "HarmonicsTable.h"
 #include "MidiEvent.h"
+#include "WavetableBank.h"
 #include "spdlog/spdlog.h"
 #include <fmt/format.h>
 
 using namespace fsh::synth;
 
-void Synth::setSampleRate(double sampleRate)
+template<int Order>
+Synth<Order>::Synth()
+{
+  const auto table = util::HarmonicsTable::get();
+  const auto wavetables = WavetableBank::get();
+  for (auto& voice : _voices)
+  {
+    voice.setHarmonicsTable(table);
+    voice.setWavetables(wavetables);
+  }
+  setSeed(_seed);
+}
+
+template<int Order>
+void Synth<Order>::setSeed(uint32_t seed)
+{
+  _seed = seed;
+  for (auto i = 0U; i < _voices.size(); ++i)
+    _voices[i].setSeed(_seed + i);
+}
+
+template<int Order>
+void Synth<Order>::setSampleRate(double sampleRate)
 {
   for (auto& voice : _voices)
     voice.setSampleRate(sampleRate);
 }
 
-void Synth::reset()
+template<int Order>
+void Synth<Order>::reset()
 {
   for (auto& voice : _voices)
     voice.reset();
+  setSeed(_seed);
+  _pool.reset();
 }
 
-void Synth::handleMIDIEvent(const MidiEvent& evt)
+template<int Order>
+void Synth<Order>::handleMIDIEvent(const MidiEvent& evt)
 {
   switch (evt.type())
   {
     using enum MidiEvent::Type;
     case NoteOn:
+    {
       spdlog::debug("currently active voices: {}", numActiveVoices());
-      for (auto& voice : _voices)
-        if (!voice.isActive())
-          return voice.noteOn(evt.data1(), evt.data2());
-      return;
+
+      // A note that is already held is released first, so each note holds at most one voice. Note
+      // on values with velocity of 0 are treated as note off, and don't take up a voice:
+      const auto previous = _pool.voiceForNote(evt.data1());
+      if (previous != VoicePool::none)
+        _voices[previous].noteOff(evt.data1(), evt.data2());
+      if (evt.data2() == 0)
+        return;
+
+      const auto level = [this](size_t voice) { return _voices[voice].getLevel(); };
+      const auto voice = _pool.noteOn(evt.data1(), _stealing, level);
+      return _voices[voice].noteOn(evt.data1(), evt.data2());
+    }
     case NoteOff:
-      for (auto& voice : _voices)
-        if (voice.getNoteVal() == evt.data1())
-          voice.noteOff(evt.data1(), evt.data2());
+      if (const auto voice = _pool.voiceForNote(evt.data1()); voice != VoicePool::none)
+        _voices[voice].noteOff(evt.data1(), evt.data2());
       return;
     case PitchBend:
       for (auto& voice : _voices)
@@ -63,13 +100,17 @@ void Synth::handleMIDIEvent(const MidiEvent& evt)
   spdlog::info("Unhandled MIDI event: {:#x}", static_cast<uint8_t>(evt.type()));
 }
 
-void Synth::setParams(const Params& params)
+template<int Order>
+void Synth<Order>::setParams(const Params& params)
 {
   for (auto& voice : _voices)
     voice.setParams(params.voice);
+  _pool.setLimit(params.numVoices);
+  _stealing = params.stealing;
 }
 
-void Synth::process(juce::AudioBuffer<float>& audio, juce::MidiBuffer& midi)
+template<int Order>
+void Synth<Order>::process(juce::AudioBuffer<float>& audio, juce::MidiBuffer& midi)
 {
   audio.clear();
 
@@ -82,25 +123,40 @@ void Synth::process(juce::AudioBuffer<float>& audio, juce::MidiBuffer& midi)
     if (const auto elapsedSamples = static_cast<size_t>(msg.samplePosition) - bufferOffset;
         elapsedSamples > 0)
     {
-      for (auto& voice : _voices)
-        voice.render(audio, elapsedSamples, bufferOffset);
+      render(audio, elapsedSamples, bufferOffset);
       bufferOffset += elapsedSamples;
     }
   }
 
   if (const auto elapsedSamples = static_cast<size_t>(audio.getNumSamples()) - bufferOffset;
       elapsedSamples > 0)
-    for (auto& voice : _voices)
-      voice.render(audio, elapsedSamples, bufferOffset);
+    render(audio, elapsedSamples, bufferOffset);
 
   midi.clear();
 }
 
-auto Synth::numActiveVoices() const -> size_t
+template<int Order>
+void Synth<Order>::render(juce::AudioBuffer<float>& audio, size_t numSamples, size_t bufferOffset)
 {
-  auto numActiveVoices = 0U;
-  for (auto& voice : _voices)
-    if (voice.isActive())
-      ++numActiveVoices;
-  return numActiveVoices;
+  // Voices that have faded out go back to the pool:
+  _pool.forEachActive(
+    [&](size_t voice)
+    {
+      _voices[voice].render(audio, numSamples, bufferOffset);
+      if (!_voices[voice].isActive())
+        _pool.release(voice);
+    });
 }
+
+template<int Order>
+auto Synth<Order>::numActiveVoices() const -> size_t
+{
+  return _pool.numActive();
+}
+
+static_assert(fsh::util::maxAmbiOrder == 5, "update the explicit instantiations below");
+template class fsh::synth::Synth<1>;
+template class fsh::synth::Synth<2>;
+template class fsh::synth::Synth<3>;
+template class fsh::synth::Synth<4>;
+template class fsh::synth::Synth<5>;
@@ -22,29 +22,55 @@
 #pragma once
 #include "MidiEvent.h"
 #include "Voice.h"
+#include "VoicePool.h"
 #include <juce_audio_basics/juce_audio_basics.h>
 
 namespace fsh::synth
 {
+/// Synthesizer parameters. These are the same for all Synth instantiations.
+struct SynthParams
+{
+  VoiceParams voice;     ///< Voice parameters
+  size_t numVoices = 32; ///< Number of voices that may play at once, up to VoicePool::capacity
+
+  /// Which voice to reuse for a new note when all voices are playing
+  VoicePool::Stealing stealing = VoicePool::Stealing::Oldest;
+};
+
 /**
 Polyphonic synthesizer
 
+The synthesizer renders Ambisonics of the given order, i.e. into `(Order + 1) ^ 2` channels. See
+Voice and fx::AmbisonicEncoder for details.
+
 **Before using:** Set the sample rate using setSampleRate() and set the synthesizer's parameters
 using setParams().
 
 **To use:** Call process() to compute the next block of audio samples.
 
+Up to VoicePool::capacity voices are allocated up front, and Params::numVoices limits how many of
+them may play at once. Only the active voices are rendered. When a note starts while all voices
+are playing, a voice is stolen according to Params::stealing, see VoicePool.
+
 > This class is loosely based on code from the [JX10
 > synthesizer](https://github.com/hollance/synth-plugin-book) by Matthijs Hollemans.
 */
+template<int Order = util::maxAmbiOrder>
 class Synth
 {
 public:
   /// Synthesizer parameters
-  struct Params
-  {
-    Voice::Params voice; ///< Voice parameters
-  };
+  using Params = SynthParams;
+
+  /// Create a synthesizer. All voices share a util::HarmonicsTable for the ambisonic encoding,
+  /// since their directions are updated on every block, and a WavetableBank for the oscillators.
+  Synth();
+
+  /// Seed the voices' noise generators. Voice `i` gets `seed + i`, and the voices are reseeded on
+  /// every reset(), so the same MIDI input always renders the same audio after a reset. Several
+  /// synthesizers playing at once should use seeds that are far apart, so their noise is
+  /// uncorrelated.
+  void setSeed(uint32_t seed);
 
   /// Set the sample rate in Hz
   void setSampleRate(double sampleRate);
@@ -55,17 +81,19 @@ public:
   /// Process a block of audio samples with the given MIDI input
   void process(juce::AudioBuffer<float>&, juce::MidiBuffer&);
 
-  /// Reset the synthesizer's state
+  /// Reset the synthesizer's state, and restart the noise generators from the seed
   void reset();
 
   /// Queries the number of currently active voices
-  auto numActiveVoices() const -> size_t; // TODO: currently only returns 0!
+  auto numActiveVoices() const -> size_t;
 
 private:
   void handleMIDIEvent(const MidiEvent&);
+  void render(juce::AudioBuffer<float>&, size_t numSamples, size_t bufferOffset);
 
-  // Limited for now because sawtooth algorithm is very inefficient:
-  static const auto numVoices = 6;
-  std::array<Voice, numVoices> _voices;
+  std::array<Voice<Order>, VoicePool::capacity> _voices;
+  VoicePool _pool;
+  VoicePool::Stealing _stealing = VoicePool::Stealing::Oldest;
+  uint32_t _seed = 0;
 };
 } // namespace fsh::synth
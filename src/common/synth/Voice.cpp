@@ -22,6 +22,7 @@
 #include "Voice.h"
 #include "SphericalHarmonics.h"
 #include "spdlog/spdlog.h"
+#include <utility>
 
 using namespace fsh::synth;
 
@@ -34,25 +35,6 @@ auto midiNoteToFreq(double noteVal) -> double
   return concertAFreq * std::exp2((noteVal - concertAMidi) / 12.0);
 }
 
-void addSampleToAllChannels(juce::AudioBuffer<float>& audio,
-                            fsh::fx::AmbisonicEncoder& encoder,
-                            size_t position,
-                            float sample)
-{
-  const auto coeffs = encoder.getCoefficientsForNextSample();
-  const auto numChannelsAvailable = static_cast<size_t>(audio.getNumChannels());
-  const auto numChannelsToProcess = juce::jmin(coeffs.size(), numChannelsAvailable);
-
-  if (numChannelsAvailable < coeffs.size())
-    spdlog::warn("encoder provided {} ambisonics coefficients, "
-                 "but only {} channels are available",
-                 coeffs.size(),
-                 numChannelsAvailable);
-
-  for (auto ch = 0U; ch < numChannelsToProcess; ++ch)
-    audio.addSample(static_cast<int>(ch), static_cast<int>(position), sample * coeffs[ch]);
-}
-
 fsh::util::SphericalVector midiNoteToDirection(double midiNote, double aziCenter, double aziRange)
 {
   const auto midiNoteMin = 0.0;
@@ -66,7 +48,8 @@ fsh::util::SphericalVector midiNoteToDirection(double midiNote, double aziCenter
 }
 } // namespace
 
-void Voice::reset()
+template<int Order>
+void Voice<Order>::reset()
 {
   _oscA.reset();
   _oscB.reset();
@@ -77,22 +60,46 @@ void Voice::reset()
   _noteVal = 0;
   _velocity = 0;
   _bendValSemitones = 0.0;
+  _stealFadeLeft = 0;
 }
 
-void Voice::noteOn(uint8_t noteVal, uint8_t velocity)
+template<int Order>
+void Voice<Order>::noteOn(uint8_t noteVal, uint8_t velocity)
 {
   // Note on values with velocity of 0 are treated as note off:
   if (velocity == 0)
     return noteOff(noteVal, velocity);
 
+  if (!isActive() || _stealFadeLength == 0)
+    return startNote(noteVal, velocity);
+
+  // The voice is stolen, so the new note waits until the old one has faded out. If the voice is
+  // already fading, the fade carries on and only the new note changes:
+  _pendingNoteVal = noteVal;
+  _pendingVelocity = velocity;
+  if (_stealFadeLeft == 0)
+    _stealFadeLeft = _stealFadeLength;
+}
+
+template<int Order>
+void Voice<Order>::startNote(uint8_t noteVal, uint8_t velocity)
+{
   _noteVal = noteVal;
   _velocity = velocity;
   _ampEnv.noteOn();
   _filtEnv.noteOn();
 }
 
-void Voice::noteOff(uint8_t noteVal, uint8_t)
+template<int Order>
+void Voice<Order>::noteOff(uint8_t noteVal, uint8_t)
 {
+  // A note that hasn't started yet because the voice is still fading out is simply dropped:
+  if (_stealFadeLeft > 0 && noteVal == _pendingNoteVal)
+  {
+    _pendingVelocity = 0;
+    return;
+  }
+
   // TODO: when ADSR is done, trigger reset
   if (noteVal == _noteVal)
   {
@@ -101,14 +108,43 @@ void Voice::noteOff(uint8_t noteVal, uint8_t)
   }
 }
 
-void Voice::pitchBend(uint16_t bendVal)
+template<int Order>
+void Voice<Order>::pitchBend(uint16_t bendVal)
 {
   const auto neutralBend = 8'192;
   const auto bendRangeSemitones = 2;
   _bendValSemitones = static_cast<double>(bendVal - neutralBend) / neutralBend * bendRangeSemitones;
 }
 
-void Voice::render(juce::AudioBuffer<float>& audio, size_t numSamples, size_t bufferOffset)
+template<int Order>
+void Voice<Order>::render(juce::AudioBuffer<float>& audio, size_t numSamples, size_t bufferOffset)
+{
+  if (_stealFadeLeft > 0)
+  {
+    const auto fadeSamples = std::min(numSamples, _stealFadeLeft);
+    renderNote(audio, fadeSamples, bufferOffset);
+    numSamples -= fadeSamples;
+    bufferOffset += fadeSamples;
+
+    // The old note has faded out completely, so the new one starts from silence:
+    if (_stealFadeLeft == 0)
+    {
+      _ampEnv.reset();
+      _filtEnv.reset();
+      _filter.reset();
+      if (_pendingVelocity > 0)
+        startNote(_pendingNoteVal, _pendingVelocity);
+    }
+  }
+
+  if (numSamples > 0)
+    renderNote(audio, numSamples, bufferOffset);
+}
+
+template<int Order>
+void Voice<Order>::renderNote(juce::AudioBuffer<float>& audio,
+                              size_t numSamples,
+                              size_t bufferOffset)
 {
   _oscA.setParams(_params.oscA);
   _oscB.setParams(_params.oscB);
@@ -120,9 +156,11 @@ void Voice::render(juce::AudioBuffer<float>& audio, size_t numSamples, size_t bu
   _oscB.setFrequency(oscFreq);
   _oscC.setFrequency(oscFreq);
 
+  // Linear smoothing, so the encoder runs at constant gains while the note doesn't move:
   _encoder.setParams({
     .direction = midiNoteToDirection(oscNote, _params.aziCenter, _params.aziRange),
-    .order = fsh::util::maxAmbiOrder,
+    .order = Order,
+    .smoothing = fx::AmbisonicEncoder<Order>::Smoothing::Linear,
   });
 
   _ampEnv.setParams(_params.ampEnv);
@@ -143,19 +181,33 @@ void Voice::render(juce::AudioBuffer<float>& audio, size_t numSamples, size_t bu
 
   const auto bufferSize = static_cast<size_t>(audio.getNumSamples());
 
-  for (auto n = bufferOffset; n < bufferOffset + numSamples; ++n)
+  if (bufferOffset + numSamples > bufferSize)
+    return spdlog::critical("bufferOffset ({}) + numSamples ({}) > bufferSize ({})",
+                            bufferOffset,
+                            numSamples,
+                            bufferSize);
+
+  // Render the mono voice signal in short chunks, so it can be encoded one chunk at a time without
+  // allocating a buffer on the audio thread:
+  auto mono = std::array<float, 64>{};
+
+  for (auto start = 0UL; start < numSamples; start += mono.size())
   {
-    if (n >= bufferSize)
-      return spdlog::critical("bufferOffset ({}) + numSamples ({}) > bufferSize ({})",
-                              bufferOffset,
-                              numSamples,
-                              bufferSize);
+    const auto length = std::min(mono.size(), numSamples - start);
 
-    addSampleToAllChannels(audio, _encoder, n, nextSample());
+    for (auto i = 0UL; i < length; ++i)
+      mono[i] = nextSample();
+
+    _encoder.encodeBlock(mono.data(),
+                         audio,
+                         static_cast<int>(length),
+                         true,
+                         static_cast<int>(bufferOffset + start));
   }
 }
 
-void Voice::setSampleRate(double sampleRate)
+template<int Order>
+void Voice<Order>::setSampleRate(double sampleRate)
 {
   _oscA.setSampleRate(sampleRate);
   _oscB.setSampleRate(sampleRate);
@@ -164,14 +216,40 @@ void Voice::setSampleRate(double sampleRate)
   _filtEnv.setSampleRate(sampleRate);
   _encoder.setSampleRate(sampleRate);
   _filter.setSampleRate(sampleRate);
+  _stealFadeLength = static_cast<size_t>(stealFadeMilliseconds / 1'000.0 * sampleRate);
+}
+
+template<int Order>
+void Voice<Order>::setHarmonicsTable(std::shared_ptr<const util::HarmonicsTable> table)
+{
+  _encoder.setHarmonicsTable(std::move(table));
+}
+
+template<int Order>
+void Voice<Order>::setWavetables(std::shared_ptr<const WavetableBank> wavetables)
+{
+  _oscA.setWavetables(wavetables);
+  _oscB.setWavetables(wavetables);
+  _oscC.setWavetables(std::move(wavetables));
 }
 
-void Voice::setParams(const Params& params)
+template<int Order>
+void Voice<Order>::setSeed(uint32_t seed)
+{
+  // Different seeds for each oscillator, so they don't cancel out or add up:
+  _oscA.setSeed(3 * seed + 0);
+  _oscB.setSeed(3 * seed + 1);
+  _oscC.setSeed(3 * seed + 2);
+}
+
+template<int Order>
+void Voice<Order>::setParams(const Params& params)
 {
   _params = params;
 }
 
-auto Voice::nextSample() -> float
+template<int Order>
+auto Voice<Order>::nextSample() -> float
 {
   if (!isActive())
     return 0.0f;
@@ -189,15 +267,33 @@ auto Voice::nextSample() -> float
   out *= static_cast<float>(_ampEnv.getNextValue());
   out *= _params.masterLevel;
 
+  if (_stealFadeLeft > 0)
+    out *= static_cast<float>(--_stealFadeLeft) / static_cast<float>(_stealFadeLength);
+
   return out;
 }
 
-auto Voice::getNoteVal() const -> uint8_t
+template<int Order>
+auto Voice<Order>::getNoteVal() const -> uint8_t
 {
   return isActive() ? _noteVal : 0;
 }
 
-auto Voice::isActive() const -> bool
+template<int Order>
+auto Voice<Order>::isActive() const -> bool
 {
-  return _ampEnv.isActive();
+  return _ampEnv.isActive() || _stealFadeLeft > 0;
 }
+
+template<int Order>
+auto Voice<Order>::getLevel() const -> double
+{
+  return _ampEnv.getCurrentValue();
+}
+
+static_assert(fsh::util::maxAmbiOrder == 5, "update the explicit instantiations below");
+template class fsh::synth::Voice<1>;
+template class fsh::synth::Voice<2>;
+template class fsh::synth::Voice<3>;
+template class fsh::synth::Voice<4>;
+template class fsh::synth::Voice<5>;
@@ -31,37 +31,50 @@
 
 namespace fsh::synth
 {
+/// Voice parameters. These are the same for all Voice instantiations.
+struct VoiceParams
+{
+  float masterLevel;             ///< Master level
+  Oscillator::Params oscA;       ///< Oscillator A parameters
+  Oscillator::Params oscB;       ///< Oscillator A parameters
+  Oscillator::Params oscC;       ///< Oscillator A parameters
+  ADSR::Params ampEnv;           ///< Amplitude envelope parameters
+  ADSR::Params filtEnv;          ///< Amplitude envelope parameters
+  float filtModAmt;              ///< How much the filter env should modulate the filter
+  double aziCenter = 0.0;        ///< Anchor middle of MIDI note range to this azimuth in degrees
+  double aziRange = 180.0;       ///< Spread MIDI range around aziCenter +/- aziRange/2
+  float filterCutoff = 1'000.0f; ///< Filter cutoff as a multiplier of oscillator frequency
+  float filterResonance = 0.0f;  ///< Filter resonance
+  float drive = 0.0;             ///< Distortion drive (dB)
+};
+
 /**
 Represents a single voice of a polyphonic synthesizer.
 
+The voice is encoded into Ambisonics of the given order, i.e. it renders into `(Order + 1) ^ 2`
+channels. See fx::AmbisonicEncoder for details.
+
 **Before using:** set the sample rate using setSampleRate() and set the voice's parameters using
 setParams().
 
 **To use:** call noteOn() to start a note, noteOff() to stop a note, and render() to compute the
 next block of audio samples.
 
+If noteOn() is called while the voice is still playing, i.e. when the voice is stolen, the old note
+is faded out over stealFadeMilliseconds before the new note starts, to avoid a click.
+
 > This class is loosely based on code from the [JX10
 > synthesizer](https://github.com/hollance/synth-plugin-book) by Matthijs Hollemans.
 */
+template<int Order = util::maxAmbiOrder>
 class Voice
 {
 public:
   /// Voice parameters
-  struct Params
-  {
-    float masterLevel;             ///< Master level
-    Oscillator::Params oscA;       ///< Oscillator A parameters
-    Oscillator::Params oscB;       ///< Oscillator A parameters
-    Oscillator::Params oscC;       ///< Oscillator A parameters
-    ADSR::Params ampEnv;           ///< Amplitude envelope parameters
-    ADSR::Params filtEnv;          ///< Amplitude envelope parameters
-    float filtModAmt;              ///< How much the filter env should modulate the filter
-    double aziCenter = 0.0;        ///< Anchor middle of MIDI note range to this azimuth in degrees
-    double aziRange = 180.0;       ///< Spread MIDI range around aziCenter +/- aziRange/2
-    float filterCutoff = 1'000.0f; ///< Filter cutoff as a multiplier of oscillator frequency
-    float filterResonance = 0.0f;  ///< Filter resonance
-    float drive = 0.0;             ///< Distortion drive (dB)
-  };
+  using Params = VoiceParams;
+
+  /// How long a stolen voice takes to fade out its old note
+  static constexpr auto stealFadeMilliseconds = 5.0;
 
   /// Set the sample rate in Hz
   void setSampleRate(double sampleRate);
@@ -69,6 +82,16 @@ public:
   /// Set the voice's parameters
   void setParams(const Params&);
 
+  /// Use a precomputed table for the ambisonic encoding, see fx::AmbisonicEncoder
+  void setHarmonicsTable(std::shared_ptr<const util::HarmonicsTable>);
+
+  /// Use the given tables for the oscillators, see Oscillator::setWavetables()
+  void setWavetables(std::shared_ptr<const WavetableBank>);
+
+  /// Seed the voice's noise generators. Voices that play at the same time should use different
+  /// seeds, so their noise is uncorrelated.
+  void setSeed(uint32_t seed);
+
   /// Start a note with the given note value and velocity
   void noteOn(uint8_t noteVal, uint8_t velocity);
 
@@ -90,11 +113,16 @@ public:
   /// Returns true if a note is currently being played
   auto isActive() const -> bool;
 
+  /// Returns the current value of the amplitude envelope
+  auto getLevel() const -> double;
+
   /// Reset the voice's state
   void reset();
 
 private:
   auto nextSample() -> float;
+  void renderNote(juce::AudioBuffer<float>& audio, size_t numSamples, size_t bufferOffset);
+  void startNote(uint8_t noteVal, uint8_t velocity);
 
   Params _params;
   uint8_t _noteVal;
@@ -102,11 +130,17 @@ private:
   uint8_t _velocity;
   ADSR _ampEnv;
   ADSR _filtEnv;
-  fx::AmbisonicEncoder _encoder;
+  fx::AmbisonicEncoder<Order> _encoder;
   Oscillator _oscA;
   Oscillator _oscB;
   Oscillator _oscC;
   fx::MoogVCF _filter;
   fx::Distortion _drive;
+
+  // The note that starts once a stolen voice has faded out, and the remaining length of the fade:
+  uint8_t _pendingNoteVal = 0;
+  uint8_t _pendingVelocity = 0;
+  size_t _stealFadeLength = 0;
+  size_t _stealFadeLeft = 0;
 };
 } // namespace fsh::synth
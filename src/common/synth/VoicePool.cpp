@@ -0,0 +1,128 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "VoicePool.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+using namespace fsh::synth;
+
+VoicePool::VoicePool(size_t limit)
+  : _limit(std::clamp(limit, size_t{ 1 }, capacity))
+{
+  reset();
+}
+
+void VoicePool::setLimit(size_t limit)
+{
+  if (limit < 1 || limit > capacity)
+  {
+    spdlog::warn("VoicePool: limit of {} voices is outside [1, {}], clamping", limit, capacity);
+    limit = std::clamp(limit, size_t{ 1 }, capacity);
+  }
+
+  if (limit == _limit)
+    return;
+
+  _limit = limit;
+  refillFreeVoices();
+}
+
+auto VoicePool::voiceForNote(uint8_t note) const -> size_t
+{
+  return note < numNotes ? _voiceOfNote[note] : none;
+}
+
+void VoicePool::release(size_t voice)
+{
+  if (voice >= capacity || !_isActive[voice])
+    return spdlog::error("VoicePool: voice {} is not active", voice);
+
+  unlink(voice);
+
+  if (voice < _limit)
+    _free[_numFree++] = voice;
+}
+
+void VoicePool::reset()
+{
+  _isActive.fill(false);
+  _voiceOfNote.fill(none);
+  _oldest = none;
+  _newest = none;
+  _numActive = 0;
+  refillFreeVoices();
+}
+
+auto VoicePool::numActive() const -> size_t
+{
+  return _numActive;
+}
+
+void VoicePool::link(size_t voice, uint8_t note)
+{
+  _prev[voice] = _newest;
+  _next[voice] = none;
+  if (_newest != none)
+    _next[_newest] = voice;
+  else
+    _oldest = voice;
+  _newest = voice;
+  ++_numActive;
+
+  _isActive[voice] = true;
+  _noteOfVoice[voice] = note;
+  if (note < numNotes)
+    _voiceOfNote[note] = voice;
+}
+
+void VoicePool::unlink(size_t voice)
+{
+  if (_prev[voice] != none)
+    _next[_prev[voice]] = _next[voice];
+  else
+    _oldest = _next[voice];
+  if (_next[voice] != none)
+    _prev[_next[voice]] = _prev[voice];
+  else
+    _newest = _prev[voice];
+  --_numActive;
+
+  _isActive[voice] = false;
+  if (const auto note = _noteOfVoice[voice]; note < numNotes && _voiceOfNote[note] == voice)
+    _voiceOfNote[note] = none;
+}
+
+void VoicePool::refillFreeVoices()
+{
+  // Push in reverse, so that the lowest voices are used first:
+  _numFree = 0;
+  for (auto voice = _limit; voice-- > 0;)
+    if (!_isActive[voice])
+      _free[_numFree++] = voice;
+}
+
+auto VoicePool::nextBelowLimit(size_t voice) const -> size_t
+{
+  while (voice != none && voice >= _limit)
+    voice = _next[voice];
+  return voice;
+}
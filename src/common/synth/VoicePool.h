@@ -0,0 +1,157 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace fsh::synth
+{
+/**
+Keeps track of which voices of a polyphonic synthesizer are playing, and which voice should play
+the next note.
+
+The pool only deals with voice indices in `[0, capacity)`; the voices themselves are owned by the
+caller. Free voices are kept on a stack and active voices in a list ordered by start time, so
+starting and releasing a voice takes constant time. A map from MIDI note to the voice that last
+started it makes note-offs constant time too. When all voices are busy, a voice is stolen according
+to the Stealing policy.
+
+**To use:** call noteOn() to get the voice for a new note, voiceForNote() to find the voice for a
+note-off, and release() once a voice has gone silent. forEachActive() iterates over the active
+voices, oldest first.
+*/
+class VoicePool
+{
+public:
+  /// Maximum number of voices
+  static constexpr size_t capacity = 128;
+
+  /// Returned instead of a voice index if there is no voice
+  static constexpr auto none = capacity;
+
+  /// Which voice to reuse for a new note when all voices are playing
+  enum class Stealing
+  {
+    Oldest,   ///< The voice that started first
+    Quietest, ///< The voice with the lowest level, e.g. the one furthest into its release
+    SameNote, ///< The voice that last played the same note if there is one, otherwise the oldest
+  };
+
+  /// Create a pool where all voices up to the limit are free
+  explicit VoicePool(size_t limit = capacity);
+
+  /// Set how many voices may play at once, from 1 to capacity. Voices above a lowered limit keep
+  /// playing until they are released, but are neither used for new notes nor stolen.
+  void setLimit(size_t limit);
+
+  /// Returns the voice that should play the given note, and marks it as the newest active voice.
+  /// If the returned voice is still active, it is stolen from its current note.
+  /// @param level returns the current level of the voice with the given index, used by
+  /// Stealing::Quietest
+  template<typename Level>
+  auto noteOn(uint8_t note, Stealing stealing, const Level& level) -> size_t
+  {
+    auto voice = _numFree > 0 ? _free[--_numFree] : none;
+
+    // Only voices below the limit are stolen, so a lowered limit takes effect as the voices above
+    // it are released. There is always one to steal, since none of them are free:
+    if (voice == none)
+      voice = [&]()
+      {
+        const auto oldest = nextBelowLimit(_oldest);
+        switch (stealing)
+        {
+          case Stealing::SameNote:
+            if (const auto sameNote = voiceForNote(note); sameNote < _limit)
+              return sameNote;
+            return oldest;
+          case Stealing::Quietest:
+          {
+            auto quietest = oldest;
+            for (auto v = nextBelowLimit(_next[oldest]); v != none; v = nextBelowLimit(_next[v]))
+              if (level(v) < level(quietest))
+                quietest = v;
+            return quietest;
+          }
+          case Stealing::Oldest:
+            break;
+        }
+        return oldest;
+      }();
+
+    if (_isActive[voice])
+      unlink(voice);
+    link(voice, note);
+    return voice;
+  }
+
+  /// Returns the voice that last started the given note, if it is still active, or none
+  auto voiceForNote(uint8_t note) const -> size_t;
+
+  /// Return a voice that has gone silent to the pool
+  void release(size_t voice);
+
+  /// Release all voices
+  void reset();
+
+  /// Returns the number of active voices
+  auto numActive() const -> size_t;
+
+  /// Call a function with the index of each active voice, oldest first. The function may
+  /// release() the voice it is called with.
+  template<typename Function>
+  void forEachActive(const Function& function)
+  {
+    for (auto voice = _oldest; voice != none;)
+    {
+      const auto next = _next[voice];
+      function(voice);
+      voice = next;
+    }
+  }
+
+private:
+  static constexpr size_t numNotes = 128;
+
+  void link(size_t voice, uint8_t note);
+  void unlink(size_t voice);
+  void refillFreeVoices();
+  auto nextBelowLimit(size_t voice) const -> size_t;
+
+  size_t _limit;
+
+  std::array<size_t, capacity> _free;
+  size_t _numFree = 0;
+
+  // Doubly linked list of the active voices, from _oldest to _newest:
+  std::array<size_t, capacity> _prev;
+  std::array<size_t, capacity> _next;
+  size_t _oldest = none;
+  size_t _newest = none;
+  size_t _numActive = 0;
+
+  std::array<bool, capacity> _isActive;
+  std::array<uint8_t, capacity> _noteOfVoice;
+  std::array<size_t, numNotes> _voiceOfNote;
+};
+} // namespace fsh::synth
@@ -0,0 +1,202 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#define _USE_MATH_DEFINES
+#include "WavetableBank.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <mutex>
+#include <optional>
+
+using namespace fsh::synth;
+
+namespace
+{
+using Waveform = Oscillator::Waveform;
+
+// The waveforms that have tables, in the order they are stored:
+constexpr auto tableWaveforms = std::array{
+  Waveform::TrueSaw, Waveform::TrueTriangle, Waveform::Square, Waveform::Saw, Waveform::Triangle,
+};
+
+constexpr auto stride = WavetableBank::tableSize + 1;
+
+constexpr auto tableIndex(Waveform waveform) -> std::optional<size_t>
+{
+  switch (waveform)
+  {
+    using enum Waveform;
+    case TrueSaw:
+      return 0;
+    case TrueTriangle:
+      return 1;
+    case Square:
+      return 2;
+    case Saw:
+      return 3;
+    case Triangle:
+      return 4;
+    case Sine:
+    case Noise:
+      return {};
+  }
+  return {};
+}
+
+static_assert(
+  []()
+  {
+    for (auto i = 0UL; i < tableWaveforms.size(); ++i)
+      if (tableIndex(tableWaveforms[i]) != i)
+        return false;
+    return true;
+  }(),
+  "tableIndex() needs to match the order of tableWaveforms");
+
+auto numHarmonics(size_t level) -> int
+{
+  const auto octaves = static_cast<double>(level) / WavetableBank::levelsPerOctave;
+  return static_cast<int>(std::floor(WavetableBank::maxHarmonics * std::exp2(-octaves)));
+}
+
+// Amplitude of the k-th harmonic, the same as in the additive oscillator:
+auto amplitude(Waveform waveform, int k) -> double
+{
+  const auto isOdd = k % 2 == 1;
+  const auto kk = static_cast<double>(k);
+  switch (waveform)
+  {
+    using enum Waveform;
+    case Saw:
+      return 1.0 / kk;
+    case TrueSaw:
+      return (isOdd ? 1.0 : -1.0) / kk;
+    case Square:
+      return isOdd ? 1.0 / kk : 0.0;
+    case Triangle:
+      return isOdd ? 1.0 / (kk * kk) : 0.0;
+    case TrueTriangle:
+      return isOdd ? (k % 4 == 1 ? 1.0 : -1.0) / (kk * kk) : 0.0;
+    case Sine:
+    case Noise:
+      return 0.0;
+  }
+  return 0.0;
+}
+} // namespace
+
+WavetableBank::WavetableBank()
+{
+  _tables.resize(tableWaveforms.size() * numLevels * stride);
+
+  // sin(2 pi k i / N) is the same as sin(2 pi ((k i) mod N) / N), so one cycle of a sine is all
+  // that needs to be evaluated:
+  auto sine = std::vector<double>(tableSize);
+  for (auto i = 0UL; i < tableSize; ++i)
+    sine[i] = std::sin(2.0 * M_PI * static_cast<double>(i) / tableSize);
+
+  // Each level has all harmonics of the level after it, and a few more. So the levels are built
+  // from the last one to the first, adding each harmonic to a running sum only once:
+  for (auto w = 0UL; w < tableWaveforms.size(); ++w)
+  {
+    auto sum = std::vector<double>(tableSize, 0.0);
+    auto harmonicsInSum = 0;
+
+    for (auto level = numLevels; level-- > 0;)
+    {
+      for (auto k = harmonicsInSum + 1; k <= numHarmonics(level); ++k)
+      {
+        const auto gain = amplitude(tableWaveforms[w], k);
+        for (auto i = 0UL; i < tableSize; ++i)
+          sum[i] += gain * sine[(static_cast<size_t>(k) * i) % tableSize];
+      }
+      harmonicsInSum = std::max(harmonicsInSum, numHarmonics(level));
+
+      auto* const samples = _tables.data() + (w * numLevels + level) * stride;
+      for (auto i = 0UL; i < tableSize; ++i)
+        samples[i] = static_cast<float>((2.0 / M_PI) * sum[i]);
+      samples[tableSize] = samples[0];
+    }
+  }
+}
+
+auto WavetableBank::get() -> std::shared_ptr<const WavetableBank>
+{
+  static auto mutex = std::mutex{};
+  static auto cache = std::weak_ptr<WavetableBank>{};
+
+  const auto lock = std::scoped_lock{ mutex };
+  if (auto bank = cache.lock())
+    return bank;
+
+  auto bank = std::make_shared<WavetableBank>();
+  cache = bank;
+  return bank;
+}
+
+auto WavetableBank::levelFor(double deltaPhase) -> Level
+{
+  // The harmonics of level m stay below Nyquist as long as x < m. So for x between m - 1 and m,
+  // level m is crossfaded into level m + 1, which reaches the next level exactly at x = m:
+  const auto x = levelsPerOctave * std::log2(2.0 * maxHarmonics * deltaPhase);
+  if (!(x >= -1.0))
+    return {};
+
+  const auto index = static_cast<size_t>(std::floor(x) + 1.0);
+  if (index >= numLevels - 1)
+    return { .index = numLevels - 1, .fade = 0.0f };
+
+  return { .index = index, .fade = static_cast<float>(x - std::floor(x)) };
+}
+
+auto WavetableBank::hasTables(Oscillator::Waveform waveform) -> bool
+{
+  return tableIndex(waveform).has_value();
+}
+
+auto WavetableBank::sample(Oscillator::Waveform waveform, const Level& level, double phase) const
+  -> float
+{
+  const auto w = tableIndex(waveform);
+  if (!w)
+    return 0.0f;
+
+  const auto position = phase * tableSize;
+  const auto i = std::min(static_cast<size_t>(position), tableSize - 1);
+  const auto frac = static_cast<float>(position - static_cast<double>(i));
+
+  const auto* const a = table(*w, level.index);
+  const auto* const b = table(*w, std::min(level.index + 1, numLevels - 1));
+  const auto sampleA = a[i] + frac * (a[i + 1] - a[i]);
+  const auto sampleB = b[i] + frac * (b[i + 1] - b[i]);
+  return sampleA + level.fade * (sampleB - sampleA);
+}
+
+auto WavetableBank::sizeInBytes() const -> size_t
+{
+  return _tables.size() * sizeof(float);
+}
+
+auto WavetableBank::table(size_t waveform, size_t level) const -> const float*
+{
+  return _tables.data() + (waveform * numLevels + level) * stride;
+}
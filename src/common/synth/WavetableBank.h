@@ -0,0 +1,104 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "Oscillator.h"
+#include <memory>
+#include <vector>
+
+namespace fsh::synth
+{
+/**
+Precomputed band-limited single-cycle tables for the harmonic waveforms of the Oscillator.
+
+Computing a sawtooth additively takes up to 100 calls to `std::sin` per sample. The bank replaces
+this by reading a table with linear interpolation. Each waveform has a series of tables (mip
+levels) with fewer and fewer harmonics: level `m` contains the harmonics up to
+`maxHarmonics * 2^(-m / levelsPerOctave)`. For a given frequency, levelFor() picks the richest
+level whose harmonics all stay below Nyquist, and the next level with fewer harmonics, and
+crossfades between them as the frequency rises, so the highest harmonics fade out smoothly instead
+of switching off. Above Nyquist, the last level is silent.
+
+The tables only depend on the phase increment per sample, not on the sample rate, so one bank
+serves all oscillators. Use get() to obtain a bank that is shared with all other users, so it is
+only built once per process:
+
+```cpp
+const auto bank = fsh::synth::WavetableBank::get();
+const auto level = bank->levelFor(deltaPhase);
+const auto out = bank->sample(Oscillator::Waveform::Saw, level, phase);
+```
+
+Sine and noise have no tables, since they have no harmonics to limit.
+*/
+class WavetableBank
+{
+public:
+  /// Number of samples per cycle of each table.
+  static constexpr size_t tableSize = 2048;
+
+  /// Number of harmonics in the richest level, the same as in Oscillator::Mode::Additive.
+  static constexpr auto maxHarmonics = 100;
+
+  /// Number of levels per octave of frequency.
+  static constexpr auto levelsPerOctave = 4;
+
+  /// Number of levels per waveform, until there are no harmonics left below Nyquist.
+  static constexpr size_t numLevels = 28;
+
+  /// The two levels to crossfade between for a given frequency, see levelFor().
+  struct Level
+  {
+    size_t index = 0;  ///< Index of the richer level
+    float fade = 0.0f; ///< Crossfade from the richer level (0) to the next one (1)
+  };
+
+  /// Build the tables. This takes a few milliseconds, so it should not be done on the audio
+  /// thread. Prefer get() to share the bank between users.
+  WavetableBank();
+
+  /// Returns a shared bank. The bank is built on the first call, and reused for as long as anyone
+  /// holds a pointer to it. This locks a mutex, so it should not be called on the audio thread.
+  static auto get() -> std::shared_ptr<const WavetableBank>;
+
+  /// Returns the levels to use for the given phase increment per sample, i.e. frequency divided by
+  /// sample rate. This takes a logarithm, so it should be called when the frequency changes, not
+  /// for every sample.
+  static auto levelFor(double deltaPhase) -> Level;
+
+  /// Returns true if the given waveform has tables.
+  static auto hasTables(Oscillator::Waveform) -> bool;
+
+  /// Read the given waveform at the given phase [0, 1), interpolated within and between the levels.
+  /// Returns 0 for waveforms without tables.
+  auto sample(Oscillator::Waveform, const Level&, double phase) const -> float;
+
+  /// Returns the size of the tables in bytes.
+  auto sizeInBytes() const -> size_t;
+
+private:
+  auto table(size_t waveform, size_t level) const -> const float*;
+
+  // All tables one after the other, each with a copy of its first sample at the end, so the
+  // interpolation never has to wrap around:
+  std::vector<float> _tables;
+};
+} // namespace fsh::synth
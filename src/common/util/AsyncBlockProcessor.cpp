@@ -0,0 +1,142 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "AsyncBlockProcessor.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+using namespace fsh::util;
+
+AsyncBlockProcessor::AsyncBlockProcessor()
+  : juce::Thread("fsh::util::AsyncBlockProcessor")
+{
+}
+
+AsyncBlockProcessor::~AsyncBlockProcessor()
+{
+  release();
+}
+
+void AsyncBlockProcessor::prepare(int numChannels,
+                                  int blockSize,
+                                  double sampleRate,
+                                  Callback callback)
+{
+  release();
+
+  _callback = std::move(callback);
+  _blockSize = std::max(blockSize, 1);
+  for (auto& block : _blocks)
+  {
+    block.setSize(numChannels, _blockSize);
+    block.clear();
+  }
+  _front = 0;
+  _blockPosition = 0;
+
+  // Real-time threads need special permissions on some systems, so fall back on a normal thread:
+  const auto options =
+    RealtimeOptions{}.withApproximateAudioProcessingTime(_blockSize, sampleRate);
+  if (!startRealtimeThread(options))
+  {
+    spdlog::warn("AsyncBlockProcessor: could not start a real-time thread, using a normal thread");
+    startThread(Priority::highest);
+  }
+}
+
+void AsyncBlockProcessor::release()
+{
+  if (!isThreadRunning())
+    return;
+
+  // Let the worker finish its block, then wake it up once more so it sees that it should exit:
+  _busy.wait(true, std::memory_order_acquire);
+  signalThreadShouldExit();
+  _busy.store(true, std::memory_order_release);
+  _busy.notify_one();
+  stopThread(-1);
+
+  _busy.store(false);
+  _blockSize = 0;
+}
+
+void AsyncBlockProcessor::process(juce::AudioBuffer<float>& audio)
+{
+  if (_blockSize == 0)
+    return;
+
+  const auto numChannels = std::min(audio.getNumChannels(), _blocks[0].getNumChannels());
+  const auto numSamples = audio.getNumSamples();
+
+  for (auto start = 0; start < numSamples;)
+  {
+    // The output of a block is needed as soon as the next block starts. When the host's block size
+    // matches, that is at the start of the next processBlock(), so the worker had all the time in
+    // between to process it:
+    if (_blockPosition == 0)
+      _busy.wait(true, std::memory_order_acquire);
+
+    const auto length = std::min(numSamples - start, _blockSize - _blockPosition);
+    auto& input = _blocks[_front];
+    const auto& output = _blocks[1 - _front];
+
+    for (auto ch = 0; ch < numChannels; ++ch)
+    {
+      input.copyFrom(ch, _blockPosition, audio, ch, start, length);
+      audio.copyFrom(ch, start, output, ch, _blockPosition, length);
+    }
+
+    _blockPosition += length;
+    start += length;
+
+    // Once the block is full, the worker gets it, and the one it processed becomes the next input:
+    if (_blockPosition == _blockSize)
+    {
+      _front = 1 - _front;
+      _blockPosition = 0;
+      _busy.store(true, std::memory_order_release);
+      _busy.notify_one();
+    }
+  }
+}
+
+auto AsyncBlockProcessor::latencySamples() const -> int
+{
+  return _blockSize;
+}
+
+void AsyncBlockProcessor::run()
+{
+  // Denormals are only disabled per thread, and decaying tails, e.g. of a reverb, produce lots:
+  const auto noDenormals = juce::ScopedNoDenormals{};
+
+  while (!threadShouldExit())
+  {
+    _busy.wait(false, std::memory_order_acquire);
+    if (threadShouldExit())
+      return;
+
+    _callback(_blocks[1 - _front]);
+
+    _busy.store(false, std::memory_order_release);
+    _busy.notify_one();
+  }
+}
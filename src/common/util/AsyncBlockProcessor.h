@@ -0,0 +1,105 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <functional>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+namespace fsh::util
+{
+/**
+Runs an audio process on its own real-time thread, one block behind the audio thread.
+
+process() collects the audio into blocks of a fixed size. Whenever a block is full, it is handed to
+the worker thread, which processes it in place with the callback, while process() returns the
+processed block sample by sample as the next block comes in. The output is delayed by
+latencySamples(), i.e. one block. If the block size is the host's block size, each block is handed
+over at the end of one processBlock() and needed at the start of the next one, so the worker runs in
+parallel with everything the audio thread does in between, e.g. rendering the next block:
+
+```cpp
+fsh::util::AsyncBlockProcessor _worker;
+
+void prepareToPlay(double sampleRate, int bufferSize)
+{
+  _worker.prepare(numChannels, bufferSize, sampleRate, [&](auto& b) { _reverb.process(b); });
+  setLatencySamples(_worker.latencySamples());
+}
+
+void processBlock(juce::AudioBuffer<float>& audio, juce::MidiBuffer&)
+{
+  _worker.process(audio);
+}
+```
+
+The two blocks are a double buffer: the audio thread fills one of them with input, while the other
+one belongs to the worker until it is processed, and is then emptied by the audio thread. They are
+handed over through a single atomic flag, without locks or allocations. If the worker isn't finished
+by the time its output is needed, the audio thread waits for it.
+*/
+class AsyncBlockProcessor : private juce::Thread
+{
+public:
+  /// Processes one block in place. This is called on the worker thread.
+  using Callback = std::function<void(juce::AudioBuffer<float>&)>;
+
+  /// Create a processor. The worker thread is only started by prepare().
+  AsyncBlockProcessor();
+
+  /// Stop the worker thread, see release().
+  ~AsyncBlockProcessor() override;
+
+  AsyncBlockProcessor(const AsyncBlockProcessor&) = delete;            ///< Not copyable
+  AsyncBlockProcessor& operator=(const AsyncBlockProcessor&) = delete; ///< Not copyable
+
+  /// Allocate the blocks and start the worker thread, which then calls the given callback for each
+  /// block. Any previous worker thread is stopped first. This allocates memory and starts a thread,
+  /// so it should not be done on the audio thread.
+  void prepare(int numChannels, int blockSize, double sampleRate, Callback);
+
+  /// Stop the worker thread, after it has finished its current block. Once this returns, the
+  /// callback is no longer called, so anything it uses can be changed.
+  void release();
+
+  /// Hand the given audio to the worker thread, and replace it with the audio it processed one
+  /// block earlier. Only the first numChannels channels are used. Does nothing unless prepared.
+  void process(juce::AudioBuffer<float>&);
+
+  /// The delay of the output in samples, i.e. the block size.
+  auto latencySamples() const -> int;
+
+private:
+  void run() override;
+
+  Callback _callback;
+  std::array<juce::AudioBuffer<float>, 2> _blocks;
+  int _blockSize = 0;
+
+  // The block that the audio thread fills with input, and the number of samples it has filled. The
+  // other block belongs to the worker while it's busy, and holds the output after that:
+  size_t _front = 0;
+  int _blockPosition = 0;
+  std::atomic<bool> _busy = false;
+};
+} // namespace fsh::util
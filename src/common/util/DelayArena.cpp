@@ -0,0 +1,91 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "DelayArena.h"
+#include <algorithm>
+#include <bit>
+
+using namespace fsh::util;
+
+namespace
+{
+// Lines are at least one cache line long, so every line starts on a cache line boundary:
+constexpr auto minLineSize = 64 / sizeof(float);
+} // namespace
+
+void DelayArena::allocate(std::span<const size_t> maxDelays)
+{
+  _offsets.resize(maxDelays.size());
+  _masks.resize(maxDelays.size());
+  _size = 0;
+
+  // A line of size n can hold delays up to n, since the oldest sample is only overwritten after
+  // it has been read:
+  for (auto line = 0UL; line < maxDelays.size(); ++line)
+  {
+    const auto lineSize = std::bit_ceil(std::max(maxDelays[line], minLineSize));
+    _offsets[line] = _size;
+    _masks[line] = lineSize - 1;
+    _size += lineSize;
+  }
+
+  _data.reset(static_cast<float*>(::operator new[](_size * sizeof(float), alignment)));
+  clear();
+}
+
+void DelayArena::clear()
+{
+  std::fill_n(_data.get(), _size, 0.0f);
+  _position = 0;
+}
+
+auto DelayArena::numLines() const -> size_t
+{
+  return _offsets.size();
+}
+
+auto DelayArena::size() const -> size_t
+{
+  return _size;
+}
+
+void DelayArena::readBlock(size_t line, size_t delay, float* output, size_t length) const
+{
+  const auto lineSize = _masks[line] + 1;
+  const auto start = (_position - delay) & _masks[line];
+  const auto first = std::min(length, lineSize - start);
+
+  // The block may wrap around the end of the line:
+  const auto* data = _data.get() + _offsets[line];
+  std::copy_n(data + start, first, output);
+  std::copy_n(data, length - first, output + first);
+}
+
+void DelayArena::writeBlock(size_t line, const float* input, size_t length)
+{
+  const auto lineSize = _masks[line] + 1;
+  const auto start = _position & _masks[line];
+  const auto first = std::min(length, lineSize - start);
+
+  auto* data = _data.get() + _offsets[line];
+  std::copy_n(input, first, data + start);
+  std::copy_n(input + first, length - first, data);
+}
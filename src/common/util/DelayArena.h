@@ -0,0 +1,123 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <vector>
+
+namespace fsh::util
+{
+/**
+A set of delay lines in one contiguous block of memory.
+
+Each line is a ring buffer whose size is a power of two, so it can wrap around with a bit mask
+instead of a modulo. The lines are stored one after the other in a single allocation, aligned to
+the cache line size, and all lines share the same write position. This makes it cheap to read or
+write one sample of every line at once (a "frame"), which is what a feedback delay network does on
+every sample:
+
+```cpp
+fsh::util::DelayArena lines;
+lines.allocate(maxDelays); // on a background thread
+
+lines.gather(delays, frame); // frame[i] = line i, delayed by delays[i]
+mix(frame);
+lines.scatter(frame);        // line i = frame[i]
+lines.advance();
+```
+
+The lines can also be read and written in blocks of consecutive samples, as long as no block is
+longer than the delay it is read at, since then every sample in it has already been written.
+
+All reads are unchecked, so the delays must not exceed the maximum delays passed to allocate().
+*/
+class DelayArena
+{
+public:
+  /// Allocate one line for each of the given maximum delays in samples, and clear them. This
+  /// allocates memory, so it should not be done on the audio thread.
+  void allocate(std::span<const size_t> maxDelays);
+
+  /// Set all lines to zero.
+  void clear();
+
+  /// Number of lines.
+  auto numLines() const -> size_t;
+
+  /// Total number of samples in all lines, including the padding to powers of two.
+  auto size() const -> size_t;
+
+  /// Read one line, delayed by the given number of samples (at least 1).
+  auto read(size_t line, size_t delay) const -> float
+  {
+    return _data[_offsets[line] + ((_position - delay) & _masks[line])];
+  }
+
+  /// Write one line at the current write position. The line must be read before it is written,
+  /// if it is read at its maximum delay.
+  void write(size_t line, float value)
+  {
+    _data[_offsets[line] + (_position & _masks[line])] = value;
+  }
+
+  /// Read all lines, each delayed by its own number of samples.
+  void gather(const size_t* delays, float* frame) const
+  {
+    for (auto line = 0UL; line < _offsets.size(); ++line)
+      frame[line] = read(line, delays[line]);
+  }
+
+  /// Write all lines at the current write position.
+  void scatter(const float* frame)
+  {
+    for (auto line = 0UL; line < _offsets.size(); ++line)
+      write(line, frame[line]);
+  }
+
+  /// Read `length` consecutive samples of one line, the first one delayed by the given number of
+  /// samples. The samples must all have been written, i.e. `length` must not exceed the delay.
+  void readBlock(size_t line, size_t delay, float* output, size_t length) const;
+
+  /// Write `length` consecutive samples of one line, starting at the current write position.
+  void writeBlock(size_t line, const float* input, size_t length);
+
+  /// Move the write position forward by the given number of samples.
+  void advance(size_t numSamples = 1) { _position += numSamples; }
+
+private:
+  static constexpr auto alignment = std::align_val_t{ 64 };
+
+  struct AlignedDelete
+  {
+    void operator()(float* data) const { ::operator delete[](data, alignment); }
+  };
+
+  std::unique_ptr<float[], AlignedDelete> _data;
+  size_t _size = 0;
+
+  std::vector<size_t> _offsets;
+  std::vector<size_t> _masks;
+  size_t _position = 0;
+};
+} // namespace fsh::util
@@ -33,6 +33,11 @@ auto EnvelopeFollower::getNextValue() -> double
   return _currentValue;
 }
 
+auto EnvelopeFollower::getCurrentValue() const -> double
+{
+  return _currentValue;
+}
+
 void EnvelopeFollower::setTargetValue(double target)
 {
   _targetValue = target;
@@ -53,6 +53,9 @@ public:
   /// Calculate the next value between the current value and the target.
   auto getNextValue() -> double;
 
+  /// Returns the current value, without advancing it.
+  auto getCurrentValue() const -> double;
+
   /// Set the target.
   void setTargetValue(double);
 
@@ -0,0 +1,217 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "FastHadamard.h"
+#include <algorithm>
+#include <cstdint>
+#include <juce_core/juce_core.h>
+
+#if JUCE_INTEL
+#include <immintrin.h>
+#endif
+
+// GCC and Clang need to be told which functions may use instructions beyond the baseline of the
+// build, MSVC allows all intrinsics everywhere:
+#if JUCE_INTEL && (defined(__GNUC__) || defined(__clang__))
+#define FSH_TARGET(isa) __attribute__((target(isa)))
+#else
+#define FSH_TARGET(isa)
+#endif
+
+using namespace fsh::util;
+
+namespace
+{
+template<size_t Size>
+void transformScalar(float* data)
+{
+  for (auto h = 1UL; h < Size; h *= 2)
+    for (auto j = 0UL; j < Size; j += 2 * h)
+      for (auto k = j; k < j + h; ++k)
+      {
+        const auto a = data[k];
+        const auto b = data[k + h];
+        data[k] = a + b;
+        data[k + h] = a - b;
+      }
+}
+
+#if JUCE_INTEL
+template<size_t Size>
+FSH_TARGET("sse2") void transformSSE2(float* data)
+{
+  // The stages inside each vector: the lower half of each pair of values is the sum, the upper
+  // half is the difference, which is done by flipping the sign bit before adding:
+  const auto negateOdd = _mm_castsi128_ps(_mm_set_epi32(INT32_MIN, 0, INT32_MIN, 0));
+  const auto negateHigh = _mm_castsi128_ps(_mm_set_epi32(INT32_MIN, INT32_MIN, 0, 0));
+
+  for (auto i = 0UL; i < Size; i += 4)
+  {
+    auto v = _mm_loadu_ps(data + i);
+    auto a = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+    auto b = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+    v = _mm_add_ps(a, _mm_xor_ps(b, negateOdd));
+    a = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 1, 0));
+    b = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 2, 3, 2));
+    v = _mm_add_ps(a, _mm_xor_ps(b, negateHigh));
+    _mm_storeu_ps(data + i, v);
+  }
+
+  for (auto h = 4UL; h < Size; h *= 2)
+    for (auto j = 0UL; j < Size; j += 2 * h)
+      for (auto k = j; k < j + h; k += 4)
+      {
+        const auto a = _mm_loadu_ps(data + k);
+        const auto b = _mm_loadu_ps(data + k + h);
+        _mm_storeu_ps(data + k, _mm_add_ps(a, b));
+        _mm_storeu_ps(data + k + h, _mm_sub_ps(a, b));
+      }
+}
+
+template<size_t Size>
+FSH_TARGET("avx2") void transformAVX2(float* data)
+{
+  // Same as SSE2 inside each 128-bit lane, then once more across the two lanes:
+  const auto negateOdd = _mm256_castsi256_ps(
+    _mm256_set_epi32(INT32_MIN, 0, INT32_MIN, 0, INT32_MIN, 0, INT32_MIN, 0));
+  const auto negateHigh = _mm256_castsi256_ps(
+    _mm256_set_epi32(INT32_MIN, INT32_MIN, 0, 0, INT32_MIN, INT32_MIN, 0, 0));
+  const auto negateUpperLane = _mm256_castsi256_ps(
+    _mm256_set_epi32(INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN, 0, 0, 0, 0));
+
+  for (auto i = 0UL; i < Size; i += 8)
+  {
+    auto v = _mm256_loadu_ps(data + i);
+    auto a = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+    auto b = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+    v = _mm256_add_ps(a, _mm256_xor_ps(b, negateOdd));
+    a = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 1, 0));
+    b = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(3, 2, 3, 2));
+    v = _mm256_add_ps(a, _mm256_xor_ps(b, negateHigh));
+    a = _mm256_permute2f128_ps(v, v, 0x00);
+    b = _mm256_permute2f128_ps(v, v, 0x11);
+    v = _mm256_add_ps(a, _mm256_xor_ps(b, negateUpperLane));
+    _mm256_storeu_ps(data + i, v);
+  }
+
+  for (auto h = 8UL; h < Size; h *= 2)
+    for (auto j = 0UL; j < Size; j += 2 * h)
+      for (auto k = j; k < j + h; k += 8)
+      {
+        const auto a = _mm256_loadu_ps(data + k);
+        const auto b = _mm256_loadu_ps(data + k + h);
+        _mm256_storeu_ps(data + k, _mm256_add_ps(a, b));
+        _mm256_storeu_ps(data + k + h, _mm256_sub_ps(a, b));
+      }
+}
+
+template<size_t Size>
+FSH_TARGET("avx512f") void transformAVX512(float* data)
+{
+  // With AVX-512, the upper half of each pair can be subtracted directly, using a mask. The lane
+  // shuffles use the zero-masking versions with all lanes enabled, since the plain versions cause a
+  // false uninitialized variable warning in GCC 12:
+  constexpr auto allLanes = __mmask16{ 0xFFFF };
+
+  for (auto i = 0UL; i < Size; i += 16)
+  {
+    auto v = _mm512_loadu_ps(data + i);
+    auto a = _mm512_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+    auto b = _mm512_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+    v = _mm512_mask_sub_ps(_mm512_add_ps(a, b), 0xAAAA, a, b);
+    a = _mm512_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 1, 0));
+    b = _mm512_shuffle_ps(v, v, _MM_SHUFFLE(3, 2, 3, 2));
+    v = _mm512_mask_sub_ps(_mm512_add_ps(a, b), 0xCCCC, a, b);
+    a = _mm512_maskz_shuffle_f32x4(allLanes, v, v, _MM_SHUFFLE(2, 2, 0, 0));
+    b = _mm512_maskz_shuffle_f32x4(allLanes, v, v, _MM_SHUFFLE(3, 3, 1, 1));
+    v = _mm512_mask_sub_ps(_mm512_add_ps(a, b), 0xF0F0, a, b);
+    a = _mm512_maskz_shuffle_f32x4(allLanes, v, v, _MM_SHUFFLE(1, 0, 1, 0));
+    b = _mm512_maskz_shuffle_f32x4(allLanes, v, v, _MM_SHUFFLE(3, 2, 3, 2));
+    v = _mm512_mask_sub_ps(_mm512_add_ps(a, b), 0xFF00, a, b);
+    _mm512_storeu_ps(data + i, v);
+  }
+
+  for (auto h = 16UL; h < Size; h *= 2)
+    for (auto j = 0UL; j < Size; j += 2 * h)
+      for (auto k = j; k < j + h; k += 16)
+      {
+        const auto a = _mm512_loadu_ps(data + k);
+        const auto b = _mm512_loadu_ps(data + k + h);
+        _mm512_storeu_ps(data + k, _mm512_add_ps(a, b));
+        _mm512_storeu_ps(data + k + h, _mm512_sub_ps(a, b));
+      }
+}
+#endif
+} // namespace
+
+auto fsh::util::detectSimdLevel() -> SimdLevel
+{
+  static const auto level = []
+  {
+#if JUCE_INTEL
+    if (juce::SystemStats::hasAVX512F())
+      return SimdLevel::AVX512;
+    if (juce::SystemStats::hasAVX2())
+      return SimdLevel::AVX2;
+    if (juce::SystemStats::hasSSE2())
+      return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+  }();
+
+  return level;
+}
+
+template<size_t Size>
+FastHadamard<Size>::FastHadamard(SimdLevel level)
+  : _level(std::min(level, detectSimdLevel()))
+  , _transform(&transformScalar<Size>)
+{
+  static_assert(Size >= 16 && (Size & (Size - 1)) == 0, "size must be a power of two >= 16");
+
+#if JUCE_INTEL
+  switch (_level)
+  {
+    case SimdLevel::AVX512:
+      _transform = &transformAVX512<Size>;
+      break;
+    case SimdLevel::AVX2:
+      _transform = &transformAVX2<Size>;
+      break;
+    case SimdLevel::SSE2:
+      _transform = &transformSSE2<Size>;
+      break;
+    case SimdLevel::Scalar:
+      break;
+  }
+#endif
+}
+
+template<size_t Size>
+auto FastHadamard<Size>::simdLevel() const -> SimdLevel
+{
+  return _level;
+}
+
+template class fsh::util::FastHadamard<16>;
+template class fsh::util::FastHadamard<32>;
+template class fsh::util::FastHadamard<64>;
+template class fsh::util::FastHadamard<128>;
@@ -0,0 +1,74 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include <cstddef>
+
+namespace fsh::util
+{
+/// Instruction sets used by the vectorized code in this library, from slowest to fastest.
+enum class SimdLevel
+{
+  Scalar, ///< plain C++, for CPUs other than x86
+  SSE2,   ///< 4 floats per instruction
+  AVX2,   ///< 8 floats per instruction
+  AVX512, ///< 16 floats per instruction
+};
+
+/// The fastest instruction set supported by this CPU. This is detected once, on the first call.
+auto detectSimdLevel() -> SimdLevel;
+
+/**
+Fast Walsh-Hadamard transform of a fixed size, vectorized for the instruction set of the CPU.
+
+The transform is not normalized, i.e. the result is `sqrt(Size)` times larger than with the
+orthonormal Hadamard matrix. Callers can usually fold the normalization into a gain they apply
+anyway, which saves a multiplication per value.
+
+The implementation is chosen once, when the object is created, so the transform itself is a
+single indirect call:
+
+```cpp
+const auto hadamard = fsh::util::FastHadamard<64>{};
+hadamard(data); // data points to 64 floats
+```
+
+The stages of size up to the vector width are done with shuffles inside each vector, and the
+larger stages as butterflies between whole vectors. Available for sizes 16, 32, 64 and 128.
+*/
+template<size_t Size>
+class FastHadamard
+{
+public:
+  /// Use the given instruction set, or the fastest one supported by the CPU if that is slower.
+  explicit FastHadamard(SimdLevel = detectSimdLevel());
+
+  /// Transform `Size` values in place. The data does not need to be aligned.
+  void operator()(float* data) const { _transform(data); }
+
+  /// The instruction set that is actually used.
+  auto simdLevel() const -> SimdLevel;
+
+private:
+  SimdLevel _level;
+  void (*_transform)(float*);
+};
+} // namespace fsh::util
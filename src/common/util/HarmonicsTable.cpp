@@ -0,0 +1,205 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "HarmonicsTable.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numbers>
+#include <spdlog/spdlog.h>
+
+using namespace fsh::util;
+
+namespace
+{
+constexpr auto numChannels = static_cast<size_t>(maxNumChannels);
+
+// Number of grid steps needed to cover `range` degrees with steps of at most `resolution` degrees:
+auto numSteps(double range, double resolution) -> size_t
+{
+  return static_cast<size_t>(std::max(1.0, std::ceil(range / resolution)));
+}
+} // namespace
+
+HarmonicsTable::HarmonicsTable(double resolution, Normalization norm)
+  : _resolution(resolution)
+  , _normalization(norm)
+{
+  if (!(resolution > 0.0 && resolution <= 90.0))
+  {
+    spdlog::warn("HarmonicsTable: invalid resolution {}, using {}", resolution, defaultResolution);
+    _resolution = defaultResolution;
+  }
+
+  // The steps are shrunk slightly if necessary, so the grid ends exactly at 180 degrees azimuth and
+  // +/- 90 degrees elevation:
+  _numAzimuthSteps = numSteps(360.0, _resolution);
+  _numElevationSteps = numSteps(180.0, _resolution);
+  _azimuthStep = static_cast<float>(360.0 / static_cast<double>(_numAzimuthSteps));
+  _elevationStep = static_cast<float>(180.0 / static_cast<double>(_numElevationSteps));
+
+  // Azimuth -180 is stored a second time as +180, so interpolation never needs to wrap around:
+  const auto numColumns = _numAzimuthSteps + 1;
+  const auto numRows = _numElevationSteps + 1;
+  _table.resize(numRows * numColumns * numChannels);
+
+  // One row of constant elevation at a time, using the batch version of harmonics(), which stores
+  // the channels of all directions one after the other. The table stores the channels of each
+  // direction next to each other, so the row is transposed on the way in:
+  auto azimuth = std::vector<float>(numColumns);
+  auto elevation = std::vector<float>(numColumns);
+  auto row = std::vector<float>(numColumns * numChannels);
+
+  for (auto col = 0U; col < numColumns; ++col)
+    azimuth[col] = -180.0f + static_cast<float>(col) * _azimuthStep;
+
+  for (auto r = 0U; r < numRows; ++r)
+  {
+    std::fill(elevation.begin(), elevation.end(), -90.0f + static_cast<float>(r) * _elevationStep);
+    harmonics(azimuth, elevation, row, _normalization);
+
+    for (auto col = 0U; col < numColumns; ++col)
+      for (auto ch = 0U; ch < numChannels; ++ch)
+        _table[(r * numColumns + col) * numChannels + ch] = row[ch * numColumns + col];
+  }
+}
+
+auto HarmonicsTable::get(double resolution, Normalization norm)
+  -> std::shared_ptr<const HarmonicsTable>
+{
+  static auto mutex = std::mutex{};
+  static auto cache = std::map<std::pair<double, Normalization>, std::weak_ptr<HarmonicsTable>>{};
+
+  const auto lock = std::scoped_lock{ mutex };
+  auto& entry = cache[{ resolution, norm }];
+
+  if (auto table = entry.lock())
+    return table;
+
+  auto table = std::make_shared<HarmonicsTable>(resolution, norm);
+  entry = table;
+  return table;
+}
+
+void HarmonicsTable::lookup(const SphericalVector& direction, std::span<float> coefficients) const
+{
+  if (coefficients.size() > numChannels)
+  {
+    spdlog::error("HarmonicsTable: requested {} channels, table only has {}",
+                  coefficients.size(),
+                  numChannels);
+    return;
+  }
+
+  // Elevations beyond the poles are folded back over the pole to the opposite azimuth, the same way
+  // harmonics() treats them:
+  auto azimuth = static_cast<float>(direction.azimuth);
+  auto elevation = static_cast<float>(direction.elevation);
+  elevation -= 360.0f * std::floor((elevation + 180.0f) / 360.0f);
+  if (elevation > 90.0f || elevation < -90.0f)
+  {
+    elevation = std::copysign(180.0f, elevation) - elevation;
+    azimuth += 180.0f;
+  }
+
+  // Position on the grid in units of steps, with the azimuth wrapped to [-180, 180):
+  auto x = (azimuth + 180.0f) / _azimuthStep;
+  x -= std::floor(x / static_cast<float>(_numAzimuthSteps)) * static_cast<float>(_numAzimuthSteps);
+  auto y = (elevation + 90.0f) / _elevationStep;
+  y = std::clamp(y, 0.0f, static_cast<float>(_numElevationSteps));
+
+  const auto col = std::min(static_cast<size_t>(x), _numAzimuthSteps - 1);
+  const auto row = std::min(static_cast<size_t>(y), _numElevationSteps - 1);
+  const auto fracX = x - static_cast<float>(col);
+  const auto fracY = y - static_cast<float>(row);
+
+  const auto numColumns = _numAzimuthSteps + 1;
+  const auto* const bottomLeft = _table.data() + (row * numColumns + col) * numChannels;
+  const auto* const bottomRight = bottomLeft + numChannels;
+  const auto* const topLeft = bottomLeft + numColumns * numChannels;
+  const auto* const topRight = topLeft + numChannels;
+
+  const auto weightBottomLeft = (1.0f - fracX) * (1.0f - fracY);
+  const auto weightBottomRight = fracX * (1.0f - fracY);
+  const auto weightTopLeft = (1.0f - fracX) * fracY;
+  const auto weightTopRight = fracX * fracY;
+
+  for (auto ch = 0U; ch < coefficients.size(); ++ch)
+    coefficients[ch] = weightBottomLeft * bottomLeft[ch] + weightBottomRight * bottomRight[ch] +
+                       weightTopLeft * topLeft[ch] + weightTopRight * topRight[ch];
+}
+
+auto HarmonicsTable::measureAccuracy(size_t numDirections) const -> Accuracy
+{
+  auto result = Accuracy{};
+  result.numDirections = numDirections;
+  auto sumOfSquares = 0.0;
+  auto interpolated = std::array<float, numChannels>{};
+
+  // Fibonacci lattice, which covers the sphere evenly without lining up with the table grid:
+  const auto goldenAngle = 180.0 * (3.0 - std::sqrt(5.0));
+  for (auto i = 0U; i < numDirections; ++i)
+  {
+    const auto z = 1.0 - 2.0 * (i + 0.5) / static_cast<double>(numDirections);
+    const auto direction = SphericalVector{
+      .azimuth = std::fmod(i * goldenAngle, 360.0) - 180.0,
+      .elevation = std::asin(z) * 180.0 / std::numbers::pi,
+    };
+
+    const auto exact = harmonics(direction, _normalization);
+    lookup(direction, interpolated);
+
+    for (auto ch = 0U; ch < numChannels; ++ch)
+    {
+      const auto error = std::abs(interpolated[ch] - exact[ch]);
+      sumOfSquares += static_cast<double>(error) * static_cast<double>(error);
+      if (error > result.maxError)
+      {
+        result.maxError = error;
+        result.worstDirection = direction;
+      }
+    }
+  }
+
+  if (numDirections > 0)
+  {
+    const auto numValues = static_cast<double>(numDirections * numChannels);
+    result.rmsError = static_cast<float>(std::sqrt(sumOfSquares / numValues));
+  }
+
+  return result;
+}
+
+auto HarmonicsTable::resolution() const -> double
+{
+  return _resolution;
+}
+
+auto HarmonicsTable::normalization() const -> Normalization
+{
+  return _normalization;
+}
+
+auto HarmonicsTable::sizeInBytes() const -> size_t
+{
+  return _table.size() * sizeof(float);
+}
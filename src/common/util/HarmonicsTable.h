@@ -0,0 +1,106 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "SphericalHarmonics.h"
+#include "SphericalVector.h"
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace fsh::util
+{
+/**
+Precomputed spherical harmonics on a regular azimuth/elevation grid.
+
+Evaluating harmonics() for a single direction takes a handful of trigonometric functions and 36
+polynomials. The table replaces this by reading the four surrounding grid points and interpolating
+bilinearly between them. Each grid point stores all maxNumChannels coefficients next to each other,
+so a lookup touches only four short, contiguous runs of memory.
+
+Tables are immutable once built. Use get() to obtain a table that is shared with all other users
+of the same resolution and normalization, so it is only built once per process:
+
+```cpp
+const auto table = fsh::util::HarmonicsTable::get();
+auto coefficients = std::array<float, fsh::util::maxNumChannels>{};
+table->lookup({ .azimuth = 30.0, .elevation = 10.0 }, coefficients);
+```
+
+The interpolation error grows with the square of the grid spacing. Use measureAccuracy() to compare
+a table against harmonics(). At the default resolution of 2 degrees, the table takes up about
+2.3 MB, and the maximum error for fifth order is below 1e-3. Halving the resolution divides the
+error by four, and multiplies the size by four.
+*/
+class HarmonicsTable
+{
+public:
+  /// Default grid spacing in degrees.
+  static constexpr auto defaultResolution = 2.0;
+
+  /// Result of measureAccuracy(), comparing the table against harmonics().
+  struct Accuracy
+  {
+    float maxError = 0.0f;          ///< largest absolute error over all channels and directions
+    float rmsError = 0.0f;          ///< root mean square error over all channels and directions
+    SphericalVector worstDirection; ///< direction where the largest error occurred
+    size_t numDirections = 0;       ///< number of directions tested
+  };
+
+  /// Build a table with the given grid spacing in degrees. This evaluates the spherical harmonics
+  /// for every grid point, so it should not be done on the audio thread. Prefer get() to share
+  /// tables between users.
+  explicit HarmonicsTable(double resolution = defaultResolution,
+                          Normalization = Normalization::SN3D);
+
+  /// Returns a shared table with the given grid spacing in degrees and normalization. The table is
+  /// built on the first call, and reused for as long as anyone holds a pointer to it. This may
+  /// take a few milliseconds and locks a mutex, so it should not be called on the audio thread.
+  static auto get(double resolution = defaultResolution, Normalization = Normalization::SN3D)
+    -> std::shared_ptr<const HarmonicsTable>;
+
+  /// Interpolate the coefficients for the given direction. The first `coefficients.size()`
+  /// channels are written, which must not be more than maxNumChannels.
+  void lookup(const SphericalVector&, std::span<float> coefficients) const;
+
+  /// Compare the table against harmonics() for `numDirections` directions spread evenly over the
+  /// sphere.
+  auto measureAccuracy(size_t numDirections = 10'000) const -> Accuracy;
+
+  /// Returns the grid spacing in degrees, as requested in the constructor.
+  auto resolution() const -> double;
+
+  /// Returns the normalization of the stored coefficients.
+  auto normalization() const -> Normalization;
+
+  /// Returns the size of the table in bytes.
+  auto sizeInBytes() const -> size_t;
+
+private:
+  double _resolution;
+  Normalization _normalization;
+  size_t _numAzimuthSteps;
+  size_t _numElevationSteps;
+  float _azimuthStep;
+  float _elevationStep;
+  std::vector<float> _table;
+};
+} // namespace fsh::util
@@ -0,0 +1,308 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "NonUniformConvolver.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <spdlog/spdlog.h>
+
+using namespace fsh::util;
+
+namespace
+{
+constexpr auto headBlockSize = NonUniformConvolver::headBlockSize;
+constexpr auto maxTailBlockSize = NonUniformConvolver::maxTailBlockSize;
+constexpr auto firstTailBlockSize = 4 * headBlockSize;
+
+static_assert(maxTailBlockSize % headBlockSize == 0,
+              "tail blocks need to start and end with a head block");
+
+// A tail segment's output for the block that ends at the current sample is only needed one block
+// later, and then plays for a block, so the first sample it can contribute is 2 * blockSize
+// samples after its input. The head's output plays one head block after its input, so this is
+// relative to the head:
+constexpr auto tailOffset(size_t blockSize) -> size_t
+{
+  return 2 * blockSize - headBlockSize;
+}
+
+constexpr auto nextBlockSize(size_t blockSize) -> size_t
+{
+  return std::min(4 * blockSize, maxTailBlockSize);
+}
+
+auto headLength(size_t filterLength) -> size_t
+{
+  return std::min(filterLength, tailOffset(firstTailBlockSize));
+}
+} // namespace
+
+/// One tail segment of the filters, convolved on its own thread, see NonUniformConvolver.
+class NonUniformConvolver::TailSegment : private juce::Thread
+{
+public:
+  TailSegment(size_t numOutputs, size_t offset, size_t length, size_t blockSize)
+    : juce::Thread("fsh::util::NonUniformConvolver")
+    , _numOutputs(numOutputs)
+    , _offset(offset)
+    , _length(length)
+    , _blockSize(blockSize)
+    , _convolver(1, numOutputs, blockSize, length)
+  {
+    for (auto i = 0UL; i < 2; ++i)
+    {
+      _input[i].resize(_blockSize);
+      _output[i].resize(_numOutputs * _blockSize);
+      for (auto output = 0UL; output < _numOutputs; ++output)
+        _outputPointers[i].push_back(_output[i].data() + output * _blockSize);
+    }
+
+    // Real-time threads need special permissions on some systems, so fall back on a normal thread:
+    if (!startRealtimeThread(RealtimeOptions{}))
+    {
+      spdlog::warn(
+        "NonUniformConvolver: could not start a real-time thread, using a normal thread");
+      startThread(Priority::highest);
+    }
+  }
+
+  ~TailSegment() override
+  {
+    // Let the thread finish its block, then wake it up once more so it sees that it should exit:
+    _busy.wait(true, std::memory_order_acquire);
+    signalThreadShouldExit();
+    _busy.store(true, std::memory_order_release);
+    _busy.notify_one();
+    stopThread(-1);
+  }
+
+  TailSegment(const TailSegment&) = delete;
+  TailSegment& operator=(const TailSegment&) = delete;
+
+  auto convolver() -> PartitionedConvolver& { return _convolver; }
+  auto convolver() const -> const PartitionedConvolver& { return _convolver; }
+
+  void setFilter(size_t output, std::span<const float> filter)
+  {
+    const auto start = std::min(_offset, filter.size());
+    const auto length = std::min(_length, filter.size() - start);
+    _convolver.setFilter(0, output, filter.subspan(start, length));
+  }
+
+  // Collect a chunk of input. The chunk never crosses the end of a block:
+  void write(const float* input, size_t length)
+  {
+    std::copy_n(input, length, _input[_front].begin() + static_cast<std::ptrdiff_t>(_position));
+  }
+
+  // Add a chunk of the output from two blocks ago, and hand the input block over to the thread once
+  // it's full. The output is written after all inputs have been read, since they may overlap:
+  void read(float* const* outputs, size_t start, size_t length)
+  {
+    for (auto output = 0UL; output < _numOutputs; ++output)
+    {
+      const auto* const block = _outputPointers[_front][output] + _position;
+      auto* const out = outputs[output] + start;
+      std::transform(block, block + length, out, out, std::plus{});
+    }
+
+    _position += length;
+    if (_position == _blockSize)
+    {
+      // The thread has had a whole block's time for its block, so it should be done by now. If it
+      // isn't, e.g. because the system is overloaded, the audio thread waits for it here:
+      _busy.wait(true, std::memory_order_acquire);
+      _front = 1 - _front;
+      _position = 0;
+      _busy.store(true, std::memory_order_release);
+      _busy.notify_one();
+    }
+  }
+
+  void reset()
+  {
+    _busy.wait(true, std::memory_order_acquire);
+    _convolver.reset();
+    for (auto i = 0UL; i < 2; ++i)
+    {
+      std::fill(_input[i].begin(), _input[i].end(), 0.0f);
+      std::fill(_output[i].begin(), _output[i].end(), 0.0f);
+    }
+    _front = 0;
+    _position = 0;
+  }
+
+private:
+  void run() override
+  {
+    // Denormals are only disabled per thread, and the tails of the filters produce lots:
+    const auto noDenormals = juce::ScopedNoDenormals{};
+
+    while (!threadShouldExit())
+    {
+      _busy.wait(false, std::memory_order_acquire);
+      if (threadShouldExit())
+        return;
+
+      const auto* const input = _input[1 - _front].data();
+      _convolver.process(&input, _outputPointers[1 - _front].data());
+
+      _busy.store(false, std::memory_order_release);
+      _busy.notify_one();
+    }
+  }
+
+  size_t _numOutputs;
+  size_t _offset;
+  size_t _length;
+  size_t _blockSize;
+  PartitionedConvolver _convolver;
+
+  // Double buffers for the input and output blocks. The audio thread writes the input block and
+  // reads the output block at _front, the background thread uses the others while it's busy:
+  std::array<std::vector<float>, 2> _input;
+  std::array<std::vector<float>, 2> _output;
+  std::array<std::vector<float*>, 2> _outputPointers;
+  size_t _front = 0;
+  size_t _position = 0;
+  std::atomic<bool> _busy = false;
+};
+
+NonUniformConvolver::NonUniformConvolver(size_t numOutputs, size_t filterLength)
+  : _numOutputs(numOutputs)
+  , _filterLength(std::max(filterLength, size_t{ 1 }))
+  , _head(1, numOutputs, headBlockSize, headLength(_filterLength))
+{
+  _headInput.resize(headBlockSize);
+  _headOutput.resize(_numOutputs * headBlockSize);
+  for (auto output = 0UL; output < _numOutputs; ++output)
+    _headOutputPointers.push_back(_headOutput.data() + output * headBlockSize);
+
+  for (auto blockSize = firstTailBlockSize; tailOffset(blockSize) < _filterLength;
+       blockSize = nextBlockSize(blockSize))
+  {
+    const auto offset = tailOffset(blockSize);
+    const auto isLast = blockSize == maxTailBlockSize;
+    const auto end = isLast ? _filterLength : std::min(_filterLength, tailOffset(4 * blockSize));
+    _tails.push_back(std::make_unique<TailSegment>(_numOutputs, offset, end - offset, blockSize));
+    if (isLast)
+      break;
+  }
+}
+
+NonUniformConvolver::~NonUniformConvolver() = default;
+
+void NonUniformConvolver::setFilter(size_t output, std::span<const float> filter)
+{
+  if (output >= _numOutputs)
+    return spdlog::error("NonUniformConvolver: output {} out of range ({})", output, _numOutputs);
+
+  if (filter.size() > _filterLength)
+  {
+    spdlog::warn("NonUniformConvolver: filter length {} truncated to {}",
+                 filter.size(),
+                 _filterLength);
+    filter = filter.first(_filterLength);
+  }
+
+  _head.setFilter(0, output, filter.first(std::min(filter.size(), headLength(_filterLength))));
+  for (auto& tail : _tails)
+    tail->setFilter(output, filter);
+}
+
+void NonUniformConvolver::writeFilters(std::ostream& stream) const
+{
+  _head.writeFilters(stream);
+  for (const auto& tail : _tails)
+    tail->convolver().writeFilters(stream);
+}
+
+auto NonUniformConvolver::readFilters(std::istream& stream) -> bool
+{
+  auto valid = _head.readFilters(stream);
+  for (auto& tail : _tails)
+    valid = valid && tail->convolver().readFilters(stream);
+
+  if (!valid)
+    for (auto output = 0UL; output < _numOutputs; ++output)
+      setFilter(output, {});
+  return valid;
+}
+
+void NonUniformConvolver::process(const float* input, float* const* outputs, size_t numSamples)
+{
+  for (auto start = 0UL; start < numSamples;)
+  {
+    const auto length = std::min(numSamples - start, headBlockSize - _blockPosition);
+    const auto offset = static_cast<std::ptrdiff_t>(_blockPosition);
+
+    // All segments read their input before any output is written, since they may overlap:
+    std::copy_n(input + start, length, _headInput.begin() + offset);
+    for (auto& tail : _tails)
+      tail->write(input + start, length);
+
+    for (auto output = 0UL; output < _numOutputs; ++output)
+      std::copy_n(_headOutputPointers[output] + offset, length, outputs[output] + start);
+
+    for (auto& tail : _tails)
+      tail->read(outputs, start, length);
+
+    _blockPosition += length;
+    start += length;
+
+    if (_blockPosition == headBlockSize)
+    {
+      const auto* const headInput = _headInput.data();
+      _head.process(&headInput, _headOutputPointers.data());
+      _blockPosition = 0;
+    }
+  }
+}
+
+void NonUniformConvolver::reset()
+{
+  _head.reset();
+  std::fill(_headInput.begin(), _headInput.end(), 0.0f);
+  std::fill(_headOutput.begin(), _headOutput.end(), 0.0f);
+  _blockPosition = 0;
+
+  for (auto& tail : _tails)
+    tail->reset();
+}
+
+auto NonUniformConvolver::numOutputs() const -> size_t
+{
+  return _numOutputs;
+}
+
+auto NonUniformConvolver::filterLength() const -> size_t
+{
+  return _filterLength;
+}
+
+auto NonUniformConvolver::latencySamples() const -> size_t
+{
+  return headBlockSize;
+}
@@ -0,0 +1,119 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "PartitionedConvolver.h"
+#include <iosfwd>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace fsh::util
+{
+/**
+Convolves one input with one long filter per output, e.g. with a room impulse response, using
+non-uniformly partitioned convolution.
+
+A util::PartitionedConvolver alone has to choose between short partitions, which are cheap per
+block but need many partitions (and complex multiply-adds) per filter, and long partitions, which
+add as much latency as they are long. So the filters are split into segments instead: the head of
+the filters is convolved with short partitions of headBlockSize samples, on the audio thread. Each
+following segment uses partitions four times as long as the one before, up to maxTailBlockSize, and
+runs on its own background thread.
+
+A tail segment with partitions of B samples starts 2 * B - headBlockSize samples into the filters.
+It gets a block of input every B samples, and its output is only needed one block later, so its
+thread has the time of a whole block to convolve it, while the audio thread carries on. The longer
+the partitions, the later the segment starts, so its output is never late. With the default sizes,
+the segments start at 0, 1792, 7936 and 32512 samples, and the last one covers the rest of the
+filters.
+
+The background threads are real-time threads where the system allows it. If a thread still hasn't
+finished its block when the output is due, process() waits for it. In the worst case, with the
+longest partitions, that is the time it takes to convolve one block of maxTailBlockSize samples
+with the whole last segment of the filters.
+
+The output is delayed by latencySamples(), i.e. one head block, regardless of the host's block size.
+
+**Before using:** set the filters using setFilter() or readFilters(). This transforms the filters,
+so it should not be done on the audio thread, nor while process() is running. The background
+threads are started by the constructor, and stopped by the destructor.
+
+**To use:** call process() with any number of samples.
+*/
+class NonUniformConvolver
+{
+public:
+  /// Number of samples per partition of the head segment, which is processed on the audio thread.
+  static constexpr size_t headBlockSize = 256;
+
+  /// Maximum number of samples per partition of the tail segments.
+  static constexpr size_t maxTailBlockSize = 16384;
+
+  /// Allocate a convolver with the given number of outputs, for filters of the given length, and
+  /// start a thread for each tail segment.
+  NonUniformConvolver(size_t numOutputs, size_t filterLength);
+
+  /// Stop the background threads, after they have finished their current block.
+  ~NonUniformConvolver();
+
+  NonUniformConvolver(const NonUniformConvolver&) = delete;            ///< Not copyable
+  NonUniformConvolver& operator=(const NonUniformConvolver&) = delete; ///< Not copyable
+
+  /// Set the filter for the given output. Filters longer than filterLength() are truncated, and
+  /// filters that are never set are silent.
+  void setFilter(size_t output, std::span<const float> filter);
+
+  /// Write the transformed filters of all segments to a stream, e.g. to cache them in a file.
+  void writeFilters(std::ostream&) const;
+
+  /// Read transformed filters written by writeFilters(). Returns false, and silences all filters,
+  /// if they were written by a convolver with a different number of outputs or filter length.
+  auto readFilters(std::istream&) -> bool;
+
+  /// Convolve the given number of samples. `outputs` points to numOutputs() arrays, which may
+  /// overlap with the input.
+  void process(const float* input, float* const* outputs, size_t numSamples);
+
+  /// Clear the input history and the audio that is still in the convolution, without changing the
+  /// filters. This waits for the background threads to finish their current block.
+  void reset();
+
+  auto numOutputs() const -> size_t;     ///< Number of outputs
+  auto filterLength() const -> size_t;   ///< Maximum length of the filters in samples
+  auto latencySamples() const -> size_t; ///< The delay of the output in samples
+
+private:
+  class TailSegment;
+
+  size_t _numOutputs;
+  size_t _filterLength;
+
+  // The head segment, with its input and output blocks, and the number of samples that are filled:
+  PartitionedConvolver _head;
+  std::vector<float> _headInput;
+  std::vector<float> _headOutput;
+  std::vector<float*> _headOutputPointers;
+  size_t _blockPosition = 0;
+
+  std::vector<std::unique_ptr<TailSegment>> _tails;
+};
+} // namespace fsh::util
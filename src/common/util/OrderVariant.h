@@ -0,0 +1,82 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "SphericalHarmonics.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <utility>
+#include <variant>
+
+namespace fsh::util
+{
+/// Returns the ambisonic order for the given number of channels, or -1 if the number of channels
+/// does not correspond to a full ambisonic order.
+constexpr int orderForNumChannels(int numChannels)
+{
+  for (auto order = 0; numChannelsForOrder(order) <= static_cast<size_t>(numChannels); ++order)
+    if (numChannelsForOrder(order) == static_cast<size_t>(numChannels))
+      return order;
+  return -1;
+}
+
+static_assert(maxAmbiOrder == 5, "update OrderVariant below");
+
+/**
+Holds one instantiation of a class template that is specialized on the ambisonic order, for one
+of the orders from 1 to maxAmbiOrder.
+
+This is used by plugins to pick the instantiation that matches the bus layout at runtime, e.g.:
+
+```cpp
+fsh::util::OrderVariant<fsh::synth::Synth> _synth;
+
+void prepareToPlay(double sampleRate, int)
+{
+  const auto order = fsh::util::orderForNumChannels(getTotalNumOutputChannels());
+  fsh::util::emplaceOrder(_synth, order);
+  std::visit([&](auto& synth) { synth.setSampleRate(sampleRate); }, _synth);
+}
+```
+*/
+template<template<int> class T>
+using OrderVariant = std::variant<T<1>, T<2>, T<3>, T<4>, T<5>>;
+
+/// Replace the contents of an OrderVariant by a default-constructed `T<order>`. If the order is not
+/// supported, it is clamped to the nearest supported order and a warning is logged.
+template<template<int> class T>
+void emplaceOrder(OrderVariant<T>& variant, int order)
+{
+  if (order < 1 || order > maxAmbiOrder)
+  {
+    spdlog::warn("OrderVariant: order {} is not supported, clamping", order);
+    order = std::clamp(order, 1, maxAmbiOrder);
+  }
+
+  // Emplace the alternative at index (order - 1), i.e. T<order>:
+  [&]<size_t... Indices>(std::index_sequence<Indices...>)
+  {
+    ((Indices + 1 == static_cast<size_t>(order) ? (variant.template emplace<Indices>(), true)
+                                                : false) ||
+     ...);
+  }(std::make_index_sequence<std::variant_size_v<OrderVariant<T>>>{});
+}
+} // namespace fsh::util
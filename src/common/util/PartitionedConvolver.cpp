@@ -0,0 +1,297 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "PartitionedConvolver.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <spdlog/spdlog.h>
+
+using namespace fsh::util;
+
+namespace
+{
+auto validPartitionSize(size_t partitionSize) -> size_t
+{
+  const auto size = std::bit_ceil(std::max(partitionSize, size_t{ 1 }));
+  if (size != partitionSize)
+    spdlog::warn("PartitionedConvolver: partition size {} is not a power of two, using {}",
+                 partitionSize,
+                 size);
+  return size;
+}
+
+// The FFT is twice as long as a partition, so the filter partition and the input block fit into
+// it without wrapping around:
+auto fftOrder(size_t partitionSize) -> int
+{
+  return static_cast<int>(std::bit_width(partitionSize));
+}
+
+// Complex multiply-add of one spectrum into another, with real and imaginary parts in separate
+// arrays so the loop can be vectorized:
+void multiplyAdd(float* accReal,
+                 float* accImag,
+                 const float* aReal,
+                 const float* aImag,
+                 const float* bReal,
+                 const float* bImag,
+                 size_t numBins)
+{
+  for (auto i = 0UL; i < numBins; ++i)
+  {
+    accReal[i] += aReal[i] * bReal[i] - aImag[i] * bImag[i];
+    accImag[i] += aReal[i] * bImag[i] + aImag[i] * bReal[i];
+  }
+}
+
+template<typename T>
+void writeArray(std::ostream& stream, const std::vector<T>& values)
+{
+  stream.write(reinterpret_cast<const char*>(values.data()),
+               static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template<typename T>
+void readArray(std::istream& stream, std::vector<T>& values)
+{
+  stream.read(reinterpret_cast<char*>(values.data()),
+              static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+} // namespace
+
+PartitionedConvolver::PartitionedConvolver(size_t numInputs,
+                                           size_t numOutputs,
+                                           size_t partitionSize,
+                                           size_t maxFilterLength)
+  : _numInputs(numInputs)
+  , _numOutputs(numOutputs)
+  , _partitionSize(validPartitionSize(partitionSize))
+  , _numPartitions(std::max((maxFilterLength + _partitionSize - 1) / _partitionSize, size_t{ 1 }))
+  , _fft(fftOrder(_partitionSize))
+{
+  // JUCE needs twice the FFT size for its real-only transforms:
+  _fftBuffer.resize(4 * _partitionSize);
+
+  const auto numFilterBins = _numInputs * _numOutputs * _numPartitions * numBins();
+  _filters.real.resize(numFilterBins);
+  _filters.imag.resize(numFilterBins);
+  _numUsedPartitions.resize(_numInputs * _numOutputs);
+
+  _inputHistory.resize(_numInputs * 2 * _partitionSize);
+  _delayLine.real.resize(_numInputs * _numPartitions * numBins());
+  _delayLine.imag.resize(_numInputs * _numPartitions * numBins());
+
+  _accumulator.real.resize(numBins());
+  _accumulator.imag.resize(numBins());
+}
+
+void PartitionedConvolver::setFilter(size_t input, size_t output, std::span<const float> filter)
+{
+  if (input >= _numInputs || output >= _numOutputs)
+    return spdlog::error("PartitionedConvolver: filter {} -> {} out of range ({} x {})",
+                         input,
+                         output,
+                         _numInputs,
+                         _numOutputs);
+
+  if (filter.size() > _numPartitions * _partitionSize)
+  {
+    spdlog::warn("PartitionedConvolver: filter length {} truncated to {}",
+                 filter.size(),
+                 _numPartitions * _partitionSize);
+    filter = filter.first(_numPartitions * _partitionSize);
+  }
+
+  auto& numUsed = _numUsedPartitions[input * _numOutputs + output];
+  numUsed = 0;
+
+  // Each partition is zero-padded to the length of the FFT:
+  auto padded = std::vector<float>(2 * _partitionSize);
+  for (auto partition = 0UL; partition < _numPartitions; ++partition)
+  {
+    const auto start = std::min(partition * _partitionSize, filter.size());
+    const auto part = filter.subspan(start, std::min(_partitionSize, filter.size() - start));
+
+    std::fill(padded.begin(), padded.end(), 0.0f);
+    std::copy(part.begin(), part.end(), padded.begin());
+    forwardTransform(padded.data(), _filters, filterIndex(input, output, partition));
+
+    if (std::any_of(part.begin(), part.end(), [](float x) { return x > 0.0f || x < 0.0f; }))
+      numUsed = partition + 1;
+  }
+}
+
+void PartitionedConvolver::writeFilters(std::ostream& stream) const
+{
+  // The dimensions come first, so readFilters() can check that the spectra fit:
+  writeArray(stream, dimensions());
+
+  const auto numUsedPartitions =
+    std::vector<uint64_t>(_numUsedPartitions.begin(), _numUsedPartitions.end());
+  writeArray(stream, numUsedPartitions);
+  writeArray(stream, _filters.real);
+  writeArray(stream, _filters.imag);
+}
+
+auto PartitionedConvolver::readFilters(std::istream& stream) -> bool
+{
+  auto dimensions = std::vector<uint64_t>(4);
+  readArray(stream, dimensions);
+  if (!stream || dimensions != this->dimensions())
+  {
+    spdlog::error("PartitionedConvolver: filters don't match the size of the convolver");
+    std::fill(_numUsedPartitions.begin(), _numUsedPartitions.end(), 0);
+    return false;
+  }
+
+  auto numUsedPartitions = std::vector<uint64_t>(_numUsedPartitions.size());
+  readArray(stream, numUsedPartitions);
+  readArray(stream, _filters.real);
+  readArray(stream, _filters.imag);
+
+  const auto valid = std::all_of(numUsedPartitions.begin(),
+                                 numUsedPartitions.end(),
+                                 [&](uint64_t n) { return n <= _numPartitions; });
+  if (!stream || !valid)
+  {
+    spdlog::error("PartitionedConvolver: could not read filters");
+    std::fill(_numUsedPartitions.begin(), _numUsedPartitions.end(), 0);
+    return false;
+  }
+
+  std::copy(numUsedPartitions.begin(), numUsedPartitions.end(), _numUsedPartitions.begin());
+  return true;
+}
+
+void PartitionedConvolver::process(const float* const* inputs, float* const* outputs)
+{
+  const auto bins = numBins();
+  _newestPartition = (_newestPartition + 1) % _numPartitions;
+
+  // Overlap-save: each input block is transformed together with the block before it. All inputs
+  // are read before any output is written, since they may be the same arrays:
+  for (auto input = 0UL; input < _numInputs; ++input)
+  {
+    auto* const history = _inputHistory.data() + input * 2 * _partitionSize;
+    std::copy_n(history + _partitionSize, _partitionSize, history);
+    std::copy_n(inputs[input], _partitionSize, history + _partitionSize);
+    forwardTransform(history, _delayLine, input * _numPartitions + _newestPartition);
+  }
+
+  for (auto output = 0UL; output < _numOutputs; ++output)
+  {
+    std::fill(_accumulator.real.begin(), _accumulator.real.end(), 0.0f);
+    std::fill(_accumulator.imag.begin(), _accumulator.imag.end(), 0.0f);
+
+    // Partition p of the filter is applied to the input block from p blocks ago:
+    for (auto input = 0UL; input < _numInputs; ++input)
+      for (auto p = 0UL; p < _numUsedPartitions[input * _numOutputs + output]; ++p)
+      {
+        const auto slot = (_newestPartition + _numPartitions - p) % _numPartitions;
+        const auto x = (input * _numPartitions + slot) * bins;
+        const auto h = filterIndex(input, output, p) * bins;
+        multiplyAdd(_accumulator.real.data(),
+                    _accumulator.imag.data(),
+                    _delayLine.real.data() + x,
+                    _delayLine.imag.data() + x,
+                    _filters.real.data() + h,
+                    _filters.imag.data() + h,
+                    bins);
+      }
+
+    // Only the non-negative frequencies are needed, JUCE fills in the rest by symmetry. The
+    // inverse transform is already scaled by 1 / size:
+    for (auto bin = 0UL; bin < bins; ++bin)
+    {
+      _fftBuffer[2 * bin] = _accumulator.real[bin];
+      _fftBuffer[2 * bin + 1] = _accumulator.imag[bin];
+    }
+    _fft.performRealOnlyInverseTransform(_fftBuffer.data());
+
+    // The first half of the result is wrapped around, and discarded:
+    std::copy_n(_fftBuffer.begin() + static_cast<std::ptrdiff_t>(_partitionSize),
+                _partitionSize,
+                outputs[output]);
+  }
+}
+
+void PartitionedConvolver::reset()
+{
+  std::fill(_inputHistory.begin(), _inputHistory.end(), 0.0f);
+  std::fill(_delayLine.real.begin(), _delayLine.real.end(), 0.0f);
+  std::fill(_delayLine.imag.begin(), _delayLine.imag.end(), 0.0f);
+}
+
+auto PartitionedConvolver::numInputs() const -> size_t
+{
+  return _numInputs;
+}
+
+auto PartitionedConvolver::numOutputs() const -> size_t
+{
+  return _numOutputs;
+}
+
+auto PartitionedConvolver::partitionSize() const -> size_t
+{
+  return _partitionSize;
+}
+
+auto PartitionedConvolver::numPartitions() const -> size_t
+{
+  return _numPartitions;
+}
+
+auto PartitionedConvolver::numBins() const -> size_t
+{
+  return _partitionSize + 1;
+}
+
+auto PartitionedConvolver::dimensions() const -> std::vector<uint64_t>
+{
+  return { _numInputs, _numOutputs, _partitionSize, _numPartitions };
+}
+
+auto PartitionedConvolver::filterIndex(size_t input, size_t output, size_t partition) const
+  -> size_t
+{
+  return (input * _numOutputs + output) * _numPartitions + partition;
+}
+
+void PartitionedConvolver::forwardTransform(const float* samples, Spectra& spectra, size_t index)
+{
+  std::copy_n(samples, 2 * _partitionSize, _fftBuffer.begin());
+  std::fill(_fftBuffer.begin() + static_cast<std::ptrdiff_t>(2 * _partitionSize),
+            _fftBuffer.end(),
+            0.0f);
+  _fft.performRealOnlyForwardTransform(_fftBuffer.data(), true);
+
+  auto* const real = spectra.real.data() + index * numBins();
+  auto* const imag = spectra.imag.data() + index * numBins();
+  for (auto bin = 0UL; bin < numBins(); ++bin)
+  {
+    real[bin] = _fftBuffer[2 * bin];
+    imag[bin] = _fftBuffer[2 * bin + 1];
+  }
+}
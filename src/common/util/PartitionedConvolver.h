@@ -0,0 +1,119 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <juce_dsp/juce_dsp.h>
+#include <span>
+#include <vector>
+
+namespace fsh::util
+{
+/**
+Convolves several inputs with several outputs at once, using uniformly partitioned overlap-save
+convolution.
+
+Each output is the sum of all inputs, each convolved with its own filter, i.e. a matrix of filters
+with one row per output and one column per input. The filters are split into partitions of
+partitionSize() samples, which are transformed once when they are set. For each block, the newest
+block of each input is transformed and stored in a frequency-domain delay line. The spectrum of each
+output is then accumulated over all inputs and partitions, and only transformed back once. So each
+block costs one forward FFT per input, one inverse FFT per output, and one complex multiply-add per
+bin for each partition of each filter. Partitions that only contain zeros are skipped.
+
+The spectra are stored with the real and imaginary parts in separate arrays, so the multiply-adds
+can be vectorized.
+
+**Before using:** set the filters using setFilter(). This transforms the filters, so it should not
+be done on the audio thread, nor while process() is running.
+
+**To use:** call process() with exactly partitionSize() samples per input and output. There is no
+latency beyond that of collecting a full block.
+*/
+class PartitionedConvolver
+{
+public:
+  /// Allocate a convolver for filters up to the given length. The partition size is rounded up to
+  /// a power of two.
+  PartitionedConvolver(size_t numInputs,
+                       size_t numOutputs,
+                       size_t partitionSize,
+                       size_t maxFilterLength);
+
+  /// Set the filter from the given input to the given output. Filters longer than the maximum
+  /// length are truncated, and filters that are never set are silent.
+  void setFilter(size_t input, size_t output, std::span<const float> filter);
+
+  /// Write the transformed filters to a stream, e.g. to cache them in a file.
+  void writeFilters(std::ostream&) const;
+
+  /// Read transformed filters written by writeFilters(), instead of setting them one by one.
+  /// Returns false, and silences all filters, if they were written by a convolver of a different
+  /// size, or can't be read.
+  auto readFilters(std::istream&) -> bool;
+
+  /// Convolve one block. `inputs` and `outputs` point to numInputs() and numOutputs() arrays of
+  /// partitionSize() samples each, and may overlap.
+  void process(const float* const* inputs, float* const* outputs);
+
+  /// Clear the input history, without changing the filters.
+  void reset();
+
+  auto numInputs() const -> size_t;     ///< Number of inputs
+  auto numOutputs() const -> size_t;    ///< Number of outputs
+  auto partitionSize() const -> size_t; ///< Number of samples per block and per partition
+  auto numPartitions() const -> size_t; ///< Number of partitions per filter
+
+private:
+  // Real and imaginary parts of a range of spectra, numBins() values each:
+  struct Spectra
+  {
+    std::vector<float> real;
+    std::vector<float> imag;
+  };
+
+  auto numBins() const -> size_t;
+  auto dimensions() const -> std::vector<uint64_t>;
+  auto filterIndex(size_t input, size_t output, size_t partition) const -> size_t;
+  void forwardTransform(const float* samples, Spectra&, size_t index);
+
+  size_t _numInputs;
+  size_t _numOutputs;
+  size_t _partitionSize;
+  size_t _numPartitions;
+
+  juce::dsp::FFT _fft;
+  std::vector<float> _fftBuffer;
+
+  // Filter spectra, and the number of partitions of each filter that are not all zeros:
+  Spectra _filters;
+  std::vector<size_t> _numUsedPartitions;
+
+  // The last two blocks of each input, and the frequency-domain delay line of each input, which is
+  // a ring buffer of the spectra of the last numPartitions() blocks:
+  std::vector<float> _inputHistory;
+  Spectra _delayLine;
+  size_t _newestPartition = 0;
+
+  Spectra _accumulator;
+};
+} // namespace fsh::util
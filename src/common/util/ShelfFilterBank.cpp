@@ -0,0 +1,67 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "ShelfFilterBank.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+using namespace fsh::util;
+
+template<size_t Lanes>
+void ShelfFilterBank<Lanes>::setCrossover(double frequency, double sampleRate)
+{
+  // Keep the crossover just below Nyquist, where the prewarped frequency goes to infinity:
+  const auto normalized = std::clamp(frequency / sampleRate, 0.0, 0.49);
+  const auto k = std::tan(std::numbers::pi * normalized);
+
+  _k = static_cast<float>(k);
+  _norm = static_cast<float>(1.0 / (1.0 + k));
+  _a1 = static_cast<float>((k - 1.0) / (1.0 + k));
+}
+
+template<size_t Lanes>
+void ShelfFilterBank<Lanes>::process(float* frame, const float* lowGains, const float* highGains)
+{
+  // The bilinear transform of H(s) = (high * s + low * w) / (s + w), which is `low` at DC and
+  // `high` at Nyquist. This is the transposed direct form II:
+  for (auto lane = 0UL; lane < Lanes; ++lane)
+  {
+    const auto b0 = (highGains[lane] + lowGains[lane] * _k) * _norm;
+    const auto b1 = (lowGains[lane] * _k - highGains[lane]) * _norm;
+
+    const auto input = frame[lane];
+    const auto output = b0 * input + _state[lane];
+    _state[lane] = b1 * input - _a1 * output;
+    frame[lane] = output;
+  }
+}
+
+template<size_t Lanes>
+void ShelfFilterBank<Lanes>::reset()
+{
+  _state.fill(0.0f);
+}
+
+template class fsh::util::ShelfFilterBank<16>;
+template class fsh::util::ShelfFilterBank<32>;
+template class fsh::util::ShelfFilterBank<64>;
+template class fsh::util::ShelfFilterBank<128>;
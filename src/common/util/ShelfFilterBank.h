@@ -0,0 +1,67 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include <array>
+#include <cstddef>
+
+namespace fsh::util
+{
+/**
+A bank of first-order shelving filters, one per lane, for filtering many signals at once.
+
+Each lane has its own gain below and above the crossover frequency, which all lanes share. The
+state of all lanes is stored as one array, and process() filters one value of every lane (a
+"frame") at a time, so the loop over the lanes is vectorized by the compiler:
+
+```cpp
+auto filters = fsh::util::ShelfFilterBank<64>{};
+filters.setCrossover(4000.0, sampleRate);
+
+filters.process(frame, lowGains, highGains); // 64 values, and 64 gains each
+```
+
+The filter coefficients are linear in the two gains, so they are computed from the gains on every
+call. This makes it cheap to change the gains on every sample, e.g. to crossfade between two sets.
+*/
+template<size_t Lanes>
+class ShelfFilterBank
+{
+public:
+  /// Set the frequency between the low and the high gains, in Hz.
+  void setCrossover(double frequency, double sampleRate);
+
+  /// Filter one value of each lane in place, with the given gains below and above the crossover
+  /// frequency for each lane.
+  void process(float* frame, const float* lowGains, const float* highGains);
+
+  /// Clear the state of all lanes.
+  void reset();
+
+private:
+  alignas(64) std::array<float, Lanes> _state = {};
+
+  // The prewarped crossover frequency, and the denominator of the bilinear transform:
+  float _k = 1.0f;
+  float _norm = 0.5f;
+  float _a1 = 0.0f;
+};
+} // namespace fsh::util
@@ -0,0 +1,142 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "SpeakerLayout.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <juce_core/juce_core.h>
+#include <spdlog/spdlog.h>
+#include <sstream>
+
+using namespace fsh::util;
+
+namespace
+{
+auto isValid(const SphericalVector& speaker) -> bool
+{
+  return std::isfinite(speaker.azimuth) && std::isfinite(speaker.elevation) &&
+         speaker.elevation >= -90.0 && speaker.elevation <= 90.0;
+}
+
+auto parseText(const std::string& text) -> std::optional<SpeakerLayout>
+{
+  auto layout = SpeakerLayout{};
+  auto stream = std::istringstream{ text };
+  auto lineNumber = 0;
+
+  for (auto line = std::string{}; std::getline(stream, line);)
+  {
+    ++lineNumber;
+    auto fields = std::istringstream{ line };
+    auto first = std::string{};
+    if (!(fields >> first) || first.starts_with('#'))
+      continue;
+
+    auto speaker = SphericalVector{};
+    auto rest = std::string{};
+    fields = std::istringstream{ line };
+    const auto isComplete = static_cast<bool>(fields >> speaker.azimuth >> speaker.elevation);
+    const auto hasTrailingText = (fields >> rest) && !rest.starts_with('#');
+    if (!isComplete || hasTrailingText || !isValid(speaker))
+    {
+      spdlog::error("SpeakerLayout: invalid speaker on line {}: \"{}\"", lineNumber, line);
+      return {};
+    }
+    layout.speakers.push_back(speaker);
+  }
+
+  return layout;
+}
+
+auto parseJson(const std::string& text) -> std::optional<SpeakerLayout>
+{
+  auto json = juce::var{};
+  if (const auto result = juce::JSON::parse(juce::String{ text }, json); result.failed())
+  {
+    spdlog::error("SpeakerLayout: invalid JSON: {}", result.getErrorMessage().toStdString());
+    return {};
+  }
+
+  const auto* loudspeakers = json["LoudspeakerLayout"]["Loudspeakers"].getArray();
+  if (loudspeakers == nullptr)
+  {
+    spdlog::error("SpeakerLayout: JSON file has no LoudspeakerLayout/Loudspeakers array");
+    return {};
+  }
+
+  auto channels = std::vector<std::pair<int, SphericalVector>>{};
+  for (const auto& loudspeaker : *loudspeakers)
+  {
+    if (static_cast<bool>(loudspeaker.getProperty("IsImaginary", false)))
+      continue;
+
+    const auto channel = static_cast<int>(
+      loudspeaker.getProperty("Channel", static_cast<int>(channels.size()) + 1));
+    const auto speaker = SphericalVector{
+      .azimuth = -static_cast<double>(loudspeaker.getProperty("Azimuth", 0.0)),
+      .elevation = static_cast<double>(loudspeaker.getProperty("Elevation", 0.0)),
+    };
+    if (!isValid(speaker))
+    {
+      spdlog::error("SpeakerLayout: invalid speaker for channel {}", channel);
+      return {};
+    }
+    channels.emplace_back(channel, speaker);
+  }
+
+  const auto byChannel = [](const auto& a, const auto& b) { return a.first < b.first; };
+  std::stable_sort(channels.begin(), channels.end(), byChannel);
+
+  auto layout = SpeakerLayout{};
+  for (const auto& [channel, speaker] : channels)
+    layout.speakers.push_back(speaker);
+  return layout;
+}
+} // namespace
+
+auto SpeakerLayout::fromFile(const std::filesystem::path& path) -> std::optional<SpeakerLayout>
+{
+  auto file = std::ifstream{ path };
+  if (!file)
+  {
+    spdlog::error("SpeakerLayout: could not open file {}", path.string());
+    return {};
+  }
+
+  auto text = std::ostringstream{};
+  text << file.rdbuf();
+  return fromString(text.str());
+}
+
+auto SpeakerLayout::fromString(const std::string& text) -> std::optional<SpeakerLayout>
+{
+  const auto start = text.find_first_not_of(" \t\r\n");
+  const auto isJson = start != std::string::npos && text[start] == '{';
+  auto layout = isJson ? parseJson(text) : parseText(text);
+
+  if (layout && layout->speakers.empty())
+  {
+    spdlog::error("SpeakerLayout: layout contains no speakers");
+    return {};
+  }
+  return layout;
+}
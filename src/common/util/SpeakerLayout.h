@@ -0,0 +1,68 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "SphericalVector.h"
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fsh::util
+{
+/**
+A loudspeaker layout, as a list of speaker directions.
+
+The directions use the same conventions as the rest of the toolkit, i.e. azimuth in degrees
+clockwise from the front, and elevation in degrees upwards from the horizontal plane. The order of
+the speakers is the order of the output channels.
+
+Layouts can be loaded from two file formats:
+
+- **Plain text**, with one speaker per line, given as azimuth and elevation separated by
+  whitespace. Empty lines and anything following a `#` are ignored, e.g.:
+
+  ```
+  # azimuth elevation
+  -30 0
+  30 0
+  ```
+
+- **JSON**, in the format used by the [IEM Plugin Suite](https://plugins.iem.at/), i.e. an object
+  with a `LoudspeakerLayout` object containing a `Loudspeakers` array. Each loudspeaker has an
+  `Azimuth`, an `Elevation` and optionally `IsImaginary` and `Channel`. The IEM plugins measure
+  azimuth anticlockwise, so the azimuths are flipped on loading. Imaginary speakers are skipped,
+  and the speakers are sorted by channel.
+
+Parsing errors are logged, and result in an empty optional.
+*/
+struct SpeakerLayout
+{
+  std::vector<SphericalVector> speakers; ///< speaker directions, one per output channel
+
+  /// Load a layout from a file in one of the formats above. JSON is detected by the first
+  /// non-whitespace character being `{`.
+  static auto fromFile(const std::filesystem::path&) -> std::optional<SpeakerLayout>;
+
+  /// Parse a layout from a string in one of the formats above.
+  static auto fromString(const std::string&) -> std::optional<SpeakerLayout>;
+};
+} // namespace fsh::util
@@ -24,6 +24,7 @@
 #include "SphericalVector.h"
 #include <cassert>
 #include <cmath>
+#include <spdlog/spdlog.h>
 
 using namespace fsh::util;
 using std::sqrt;
@@ -173,6 +174,164 @@ std::array<double, maxNumChannels> harmonics_sn3d(double x, double y, double z)
   };
 }
 
+// Normalization constants of the N3D polynomials above, with the cartesian polynomial part removed
+// (see batchPolynomials() below). These are precomputed so the batch version only has to do a
+// multiplication per coefficient:
+const auto batchNormalizationN3D = std::array<float, maxNumChannels>{
+  // order 0:
+  static_cast<float>(1 / (2 * sqrt(pi))),
+  // order 1:
+  static_cast<float>(sqrt(3) / (2 * sqrt(pi))),
+  static_cast<float>(sqrt(3) / (2 * sqrt(pi))),
+  static_cast<float>(sqrt(3) / (2 * sqrt(pi))),
+  // order 2:
+  static_cast<float>(sqrt(15) / (2 * sqrt(pi))),
+  static_cast<float>(sqrt(15) / (2 * sqrt(pi))),
+  static_cast<float>(sqrt(5) / (4 * sqrt(pi))),
+  static_cast<float>(sqrt(15) / (2 * sqrt(pi))),
+  static_cast<float>(sqrt(15) / (4 * sqrt(pi))),
+  // order 3:
+  static_cast<float>(sqrt(2) * sqrt(35) / (8 * sqrt(pi))),
+  static_cast<float>(sqrt(105) / (2 * sqrt(pi))),
+  static_cast<float>(sqrt(2) * sqrt(21) / (8 * sqrt(pi))),
+  static_cast<float>(sqrt(7) / (4 * sqrt(pi))),
+  static_cast<float>(sqrt(2) * sqrt(21) / (8 * sqrt(pi))),
+  static_cast<float>(sqrt(105) / (4 * sqrt(pi))),
+  static_cast<float>(sqrt(2) * sqrt(35) / (8 * sqrt(pi))),
+  // order 4:
+  static_cast<float>(3 * sqrt(35) / (4 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(2) * sqrt(35) / (8 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(5) / (4 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(2) * sqrt(5) / (8 * sqrt(pi))),
+  static_cast<float>(3 / (16 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(2) * sqrt(5) / (8 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(5) / (8 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(2) * sqrt(35) / (8 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(35) / (16 * sqrt(pi))),
+  // order 5:
+  static_cast<float>(3 * sqrt(2) * sqrt(77) / (32 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(385) / (4 * sqrt(pi))),
+  static_cast<float>(sqrt(2) * sqrt(385) / (32 * sqrt(pi))),
+  static_cast<float>(sqrt(1155) / (4 * sqrt(pi))),
+  static_cast<float>(sqrt(165) / (16 * sqrt(pi))),
+  static_cast<float>(sqrt(11) / (16 * sqrt(pi))),
+  static_cast<float>(sqrt(165) / (16 * sqrt(pi))),
+  static_cast<float>(sqrt(1155) / (8 * sqrt(pi))),
+  static_cast<float>(sqrt(2) * sqrt(385) / (32 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(385) / (16 * sqrt(pi))),
+  static_cast<float>(3 * sqrt(2) * sqrt(77) / (32 * sqrt(pi))),
+};
+
+// Same as above, divided by a factor of sqrt(2 * order + 1) for SN3D:
+const auto batchNormalizationSN3D = []()
+{
+  auto normalization = batchNormalizationN3D;
+  for (auto i = 0U; i < normalization.size(); ++i)
+  {
+    const auto order = std::floor(std::sqrt(static_cast<float>(i)));
+    normalization[i] /= std::sqrt(2 * order + 1);
+  }
+  return normalization;
+}();
+
+// The number of directions that batchPolynomials() processes at once. The whole batch (inputs and
+// outputs) lives on the stack and fits comfortably into the L1 cache:
+constexpr auto batchSize = size_t{ 64 };
+
+template<typename T>
+using Batch = std::array<T, batchSize>;
+
+// Evaluates the cartesian polynomials from harmonics_n3d() above (without normalization constants)
+// for a batch of directions. The loop body is branch-free and all arrays are local, so the compiler
+// can vectorize it across directions:
+void batchPolynomials(const Batch<float>& xs,
+                      const Batch<float>& ys,
+                      const Batch<float>& zs,
+                      std::array<Batch<float>, maxNumChannels>& out)
+{
+  for (auto i = 0U; i < batchSize; ++i)
+  {
+    const auto x = xs[i];
+    const auto y = ys[i];
+    const auto z = zs[i];
+
+    const auto x2 = x * x;
+    const auto y2 = y * y;
+    const auto z2 = z * z;
+    const auto z4 = z2 * z2;
+
+    // order 0:
+    out[0][i] = 1.0f;
+    // order 1:
+    out[1][i] = y;
+    out[2][i] = z;
+    out[3][i] = x;
+    // order 2:
+    out[4][i] = y * x;
+    out[5][i] = y * z;
+    out[6][i] = 3 * z2 - 1;
+    out[7][i] = x * z;
+    out[8][i] = x2 - y2;
+    // order 3:
+    out[9][i] = y * (3 * x2 - y2);
+    out[10][i] = y * x * z;
+    out[11][i] = y * (-1 + 5 * z2);
+    out[12][i] = z * (5 * z2 - 3);
+    out[13][i] = x * (-1 + 5 * z2);
+    out[14][i] = (x2 - y2) * z;
+    out[15][i] = x * (x2 - 3 * y2);
+    // order 4:
+    out[16][i] = y * x * (x2 - y2);
+    out[17][i] = y * (3 * x2 - y2) * z;
+    out[18][i] = y * x * (-1 + 7 * z2);
+    out[19][i] = y * z * (-3 + 7 * z2);
+    out[20][i] = 35 * z4 - 30 * z2 + 3;
+    out[21][i] = x * z * (-3 + 7 * z2);
+    out[22][i] = (x2 - y2) * (-1 + 7 * z2);
+    out[23][i] = x * (x2 - 3 * y2) * z;
+    out[24][i] = x2 * x2 - 6 * y2 * x2 + y2 * y2;
+    // order 5:
+    out[25][i] = y * (5 * x2 * x2 - 10 * y2 * x2 + y2 * y2);
+    out[26][i] = y * x * (x2 - y2) * z;
+    out[27][i] = y * (3 * x2 - y2) * (-1 + 9 * z2);
+    out[28][i] = y * x * z * (-1 + 3 * z2);
+    out[29][i] = y * (-14 * z2 + 21 * z4 + 1);
+    out[30][i] = z * (63 * z4 - 70 * z2 + 15);
+    out[31][i] = x * (-14 * z2 + 21 * z4 + 1);
+    out[32][i] = (x2 - y2) * z * (-1 + 3 * z2);
+    out[33][i] = x * (x2 - 3 * y2) * (-1 + 9 * z2);
+    out[34][i] = (x2 * x2 - 6 * y2 * x2 + y2 * y2) * z;
+    out[35][i] = x * (x2 * x2 - 10 * y2 * x2 + 5 * y2 * y2);
+  }
+}
+
+// Normalization factors for the recurrence-based harmonics<Order>() below. Each factor combines the
+// usual N3D/SN3D normalization with the factor sqrt(2) for the non-zonal (m != 0) harmonics, and is
+// indexed by ACN channel number:
+template<int Order>
+auto recurrenceNormalization(Normalization norm)
+{
+  auto normalization = std::array<double, numChannelsForOrder(Order)>{};
+
+  for (auto l = 0; l <= Order; ++l)
+    for (auto m = -l; m <= l; ++m)
+    {
+      const auto absM = std::abs(m);
+
+      // (l - |m|)! / (l + |m|)!
+      auto factorialRatio = 1.0;
+      for (auto k = l - absM + 1; k <= l + absM; ++k)
+        factorialRatio /= k;
+
+      const auto orderFactor = (norm == Normalization::N3D) ? (2 * l + 1) : 1;
+      const auto sectoralFactor = (m == 0) ? 1.0 : sqrt(2.0);
+      const auto acn = static_cast<size_t>(l * l + l + m);
+      normalization[acn] = sectoralFactor * sqrt(orderFactor * factorialRatio / (4 * pi));
+    }
+
+  return normalization;
+}
+
 template<size_t N>
 std::array<float, N> toFloats(std::array<double, N> double_array)
 {
@@ -197,3 +356,135 @@ std::array<float, maxNumChannels> fsh::util::harmonics(const SphericalVector& ve
       return {};
   }
 }
+
+template<int Order>
+std::array<float, numChannelsForOrder(Order)> fsh::util::harmonics(const SphericalVector& vec,
+                                                                   Normalization norm)
+{
+  static_assert(Order >= 0 && Order <= maxAmbiOrder, "unsupported ambisonic order");
+
+  static const auto normalizationN3D = recurrenceNormalization<Order>(Normalization::N3D);
+  static const auto normalizationSN3D = recurrenceNormalization<Order>(Normalization::SN3D);
+  const auto& normalization =
+    (norm == Normalization::N3D) ? normalizationN3D : normalizationSN3D;
+
+  const auto [x, y, z] = toXYZ(vec);
+
+  // cos(m * azimuth) and sin(m * azimuth), scaled by cos(elevation) ^ m, via the angle addition
+  // formulas. The scaling cancels out the (1 - z^2) ^ (m/2) factor of the associated Legendre
+  // functions, so neither needs a square root:
+  auto cosines = std::array<double, Order + 1U>{};
+  auto sines = std::array<double, Order + 1U>{};
+  cosines[0] = 1.0;
+  sines[0] = 0.0;
+  for (auto m = 1U; m <= Order; ++m)
+  {
+    cosines[m] = x * cosines[m - 1] - y * sines[m - 1];
+    sines[m] = x * sines[m - 1] + y * cosines[m - 1];
+  }
+
+  auto result = std::array<float, numChannelsForOrder(Order)>{};
+  const auto store = [&](int l, int m, double legendre)
+  {
+    const auto acn = static_cast<size_t>(l * l + l + m);
+    result[acn] = static_cast<float>(normalization[acn] * legendre);
+  };
+
+  // Associated Legendre functions P(l, m) without Condon-Shortley phase, divided by
+  // (1 - z^2) ^ (m/2), using the standard three-term recurrence in l for each m:
+  auto legendreMM = 1.0; // P(m, m) = (2m - 1)!!
+  for (auto m = 0; m <= Order; ++m)
+  {
+    if (m > 0)
+      legendreMM *= 2 * m - 1;
+
+    auto previous = 0.0;
+    auto current = legendreMM;
+    for (auto l = m; l <= Order; ++l)
+    {
+      if (l == m + 1)
+      {
+        previous = current;
+        current = (2 * m + 1) * z * legendreMM;
+      }
+      else if (l > m + 1)
+      {
+        const auto next = ((2 * l - 1) * z * current - (l + m - 1) * previous) / (l - m);
+        previous = current;
+        current = next;
+      }
+
+      const auto index = static_cast<size_t>(m);
+      store(l, +m, current * cosines[index]);
+      if (m > 0)
+        store(l, -m, current * sines[index]);
+    }
+  }
+
+  return result;
+}
+
+static_assert(fsh::util::maxAmbiOrder == 5, "update the explicit instantiations below");
+template std::array<float, numChannelsForOrder(0)> fsh::util::harmonics<0>(const SphericalVector&,
+                                                                           Normalization);
+template std::array<float, numChannelsForOrder(1)> fsh::util::harmonics<1>(const SphericalVector&,
+                                                                           Normalization);
+template std::array<float, numChannelsForOrder(2)> fsh::util::harmonics<2>(const SphericalVector&,
+                                                                           Normalization);
+template std::array<float, numChannelsForOrder(3)> fsh::util::harmonics<3>(const SphericalVector&,
+                                                                           Normalization);
+template std::array<float, numChannelsForOrder(4)> fsh::util::harmonics<4>(const SphericalVector&,
+                                                                           Normalization);
+template std::array<float, numChannelsForOrder(5)> fsh::util::harmonics<5>(const SphericalVector&,
+                                                                           Normalization);
+
+void fsh::util::harmonics(std::span<const float> azimuth,
+                          std::span<const float> elevation,
+                          std::span<float> coefficients,
+                          Normalization norm)
+{
+  const auto numDirections = azimuth.size();
+
+  if (elevation.size() != numDirections || coefficients.size() < maxNumChannels * numDirections)
+  {
+    spdlog::error("harmonics: got {} azimuths, {} elevations and space for {} coefficients",
+                  azimuth.size(),
+                  elevation.size(),
+                  coefficients.size());
+    return;
+  }
+
+  const auto& normalization =
+    (norm == Normalization::N3D) ? batchNormalizationN3D : batchNormalizationSN3D;
+  const auto degreesToRadiansF = static_cast<float>(pi / 180.0);
+
+  auto xs = Batch<float>{};
+  auto ys = Batch<float>{};
+  auto zs = Batch<float>{};
+  auto polynomials = std::array<Batch<float>, maxNumChannels>{};
+
+  for (auto start = 0UL; start < numDirections; start += batchSize)
+  {
+    const auto length = std::min(batchSize, numDirections - start);
+
+    // Same coordinate conversion as toXYZ(), including the flipped azimuth. Unused lanes of the
+    // last batch keep their values from the previous batch, and are simply not copied out:
+    for (auto i = 0U; i < length; ++i)
+    {
+      const auto az = -degreesToRadiansF * azimuth[start + i];
+      const auto el = degreesToRadiansF * elevation[start + i];
+      xs[i] = std::cos(el) * std::cos(az);
+      ys[i] = std::cos(el) * std::sin(az);
+      zs[i] = std::sin(el);
+    }
+
+    batchPolynomials(xs, ys, zs, polynomials);
+
+    for (auto ch = 0U; ch < maxNumChannels; ++ch)
+    {
+      auto* const output = coefficients.data() + ch * numDirections + start;
+      for (auto i = 0U; i < length; ++i)
+        output[i] = normalization[ch] * polynomials[ch][i];
+    }
+  }
+}
@@ -22,6 +22,7 @@
 #pragma once
 #include "SphericalVector.h"
 #include <array>
+#include <span>
 
 namespace fsh::util
 {
@@ -36,6 +37,32 @@ enum class Normalization
 constexpr auto maxAmbiOrder = 5;
 constexpr auto maxNumChannels = (maxAmbiOrder + 1) * (maxAmbiOrder + 1);
 
+/// Number of ambisonic channels for a given order.
+constexpr size_t numChannelsForOrder(int order)
+{
+  return static_cast<size_t>((order + 1) * (order + 1));
+}
+
 std::array<float, maxNumChannels> harmonics(const SphericalVector&,
                                             Normalization = Normalization::SN3D);
+
+/// Evaluate the spherical harmonics up to the given order for a single direction. Unlike the
+/// non-template version, which uses hand-written polynomials up to maxAmbiOrder, this version uses
+/// the associated Legendre and sine/cosine recurrences, which work the same way for every order up
+/// to maxAmbiOrder. Only the `(Order + 1) ^ 2` coefficients that are actually needed are
+/// computed. The results are identical to harmonics() up to floating point precision.
+template<int Order>
+std::array<float, numChannelsForOrder(Order)> harmonics(const SphericalVector&,
+                                                        Normalization = Normalization::SN3D);
+
+/// Evaluate the spherical harmonics for many directions at once. Directions are passed as two
+/// arrays of azimuth/elevation values in degrees (structure-of-arrays). The coefficients are
+/// written to `coefficients` in the same layout: coefficient `ch` of direction `i` is stored at
+/// index `ch * azimuth.size() + i`, so `coefficients` must hold `maxNumChannels * azimuth.size()`
+/// values. The evaluation is done in single precision, with the directions processed in parallel
+/// lanes.
+void harmonics(std::span<const float> azimuth,
+               std::span<const float> elevation,
+               std::span<float> coefficients,
+               Normalization = Normalization::SN3D);
 } // namespace fsh::util
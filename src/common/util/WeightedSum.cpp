@@ -0,0 +1,55 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "WeightedSum.h"
+
+void fsh::util::addWeightedSum(float* output,
+                               const float* gains,
+                               const float* const* inputs,
+                               size_t numInputs,
+                               size_t length)
+{
+  auto input = 0UL;
+
+  for (; input + 4 <= numInputs; input += 4)
+  {
+    const auto* const a = inputs[input];
+    const auto* const b = inputs[input + 1];
+    const auto* const c = inputs[input + 2];
+    const auto* const d = inputs[input + 3];
+    const auto gainA = gains[input];
+    const auto gainB = gains[input + 1];
+    const auto gainC = gains[input + 2];
+    const auto gainD = gains[input + 3];
+
+    for (auto i = 0UL; i < length; ++i)
+      output[i] += gainA * a[i] + gainB * b[i] + gainC * c[i] + gainD * d[i];
+  }
+
+  for (; input < numInputs; ++input)
+  {
+    const auto* const a = inputs[input];
+    const auto gainA = gains[input];
+
+    for (auto i = 0UL; i < length; ++i)
+      output[i] += gainA * a[i];
+  }
+}
@@ -0,0 +1,37 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include <cstddef>
+
+namespace fsh::util
+{
+/// Add a weighted sum of several input signals to an output signal, i.e. `output[i] += gains[0] *
+/// inputs[0][i] + gains[1] * inputs[1][i] + ...` for `i < length`. This is the inner loop of the
+/// matrix multiplications in fx::MultiSourceEncoder and fx::AmbisonicDecoder, where `gains` is one
+/// row of the matrix, and `output` is one row of a tile that stays in the cache. Four inputs are
+/// added at a time, so the output is only loaded and stored once for every four inputs.
+void addWeightedSum(float* output,
+                    const float* gains,
+                    const float* const* inputs,
+                    size_t numInputs,
+                    size_t length);
+} // namespace fsh::util
@@ -0,0 +1,212 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "WorkerPool.h"
+#include <algorithm>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <mutex>
+#include <spdlog/spdlog.h>
+
+using namespace fsh::util;
+
+namespace
+{
+constexpr auto indexBits = 16U;
+constexpr auto indexMask = (uint64_t{ 1 } << indexBits) - 1;
+constexpr auto maxNumTasks = static_cast<size_t>(indexMask);
+
+constexpr auto pack(uint64_t generation, uint64_t numTasks, uint64_t nextTask) -> uint64_t
+{
+  return (generation << (2 * indexBits)) | (numTasks << indexBits) | nextTask;
+}
+
+constexpr auto generationOf(uint64_t state) -> uint64_t
+{
+  return state >> (2 * indexBits);
+}
+
+constexpr auto numTasksOf(uint64_t state) -> uint64_t
+{
+  return (state >> indexBits) & indexMask;
+}
+
+constexpr auto nextTaskOf(uint64_t state) -> uint64_t
+{
+  return state & indexMask;
+}
+} // namespace
+
+/// One worker thread of a WorkerPool.
+class WorkerPool::Worker : private juce::Thread
+{
+public:
+  explicit Worker(WorkerPool& pool)
+    : juce::Thread("fsh::util::WorkerPool")
+    , _pool(pool)
+  {
+    // Real-time threads need special permissions on some systems, so fall back on a normal thread:
+    if (!startRealtimeThread(RealtimeOptions{}))
+    {
+      spdlog::warn("WorkerPool: could not start a real-time thread, using a normal thread");
+      startThread(Priority::highest);
+    }
+  }
+
+  ~Worker() override { stopThread(-1); }
+
+  Worker(const Worker&) = delete;
+  Worker& operator=(const Worker&) = delete;
+
+private:
+  void run() override
+  {
+    // Denormals are only disabled per thread, so the tasks need it here as well as on the audio
+    // thread:
+    const auto noDenormals = juce::ScopedNoDenormals{};
+    _pool.workerLoop();
+  }
+
+  WorkerPool& _pool;
+};
+
+WorkerPool::WorkerPool(size_t numThreads)
+{
+  _threads.reserve(numThreads);
+  for (auto i = 0U; i < numThreads; ++i)
+    _threads.push_back(std::make_unique<Worker>(*this));
+}
+
+WorkerPool::~WorkerPool()
+{
+  _quit = true;
+
+  // Change the state, so the sleeping workers wake up and see the quit flag:
+  _state.store(pack(generationOf(_state.load()) + 1, 0, 0));
+  _state.notify_all();
+
+  _threads.clear();
+}
+
+auto WorkerPool::numThreads() const -> size_t
+{
+  return _threads.size();
+}
+
+auto WorkerPool::defaultNumThreads() -> size_t
+{
+  const auto hardwareThreads = static_cast<size_t>(juce::SystemStats::getNumCpus());
+  return std::min(hardwareThreads > 1 ? hardwareThreads - 1 : 0, maxDefaultNumThreads);
+}
+
+auto WorkerPool::shared() -> std::shared_ptr<WorkerPool>
+{
+  static auto mutex = std::mutex{};
+  static auto cache = std::weak_ptr<WorkerPool>{};
+
+  const auto lock = std::scoped_lock{ mutex };
+  if (auto pool = cache.lock())
+    return pool;
+
+  auto pool = std::make_shared<WorkerPool>();
+  cache = pool;
+  return pool;
+}
+
+void WorkerPool::runErased(size_t numTasks, TaskFunction function, void* context)
+{
+  if (numTasks > maxNumTasks)
+  {
+    spdlog::error(
+      "WorkerPool: {} tasks requested, but only {} are supported", numTasks, maxNumTasks);
+    numTasks = maxNumTasks;
+  }
+
+  if (numTasks == 0)
+    return;
+
+  // Another thread is using the workers, so do all the work here rather than wait for it:
+  if (_running.exchange(true, std::memory_order_acquire))
+  {
+    for (auto task = 0UL; task < numTasks; ++task)
+      function(context, task);
+    return;
+  }
+
+  // No task of the previous job can be claimed any more, so no worker is reading these:
+  _function = function;
+  _context = context;
+  _numTasksDone.store(0);
+
+  const auto generation = generationOf(_state.load()) + 1;
+  _state.store(pack(generation, numTasks, 0), std::memory_order_release);
+
+  if (!_threads.empty())
+    _state.notify_all();
+
+  runAvailableTasks();
+
+  // Wait for the tasks that were claimed by the workers:
+  for (auto done = _numTasksDone.load(); done < numTasks; done = _numTasksDone.load())
+    _numTasksDone.wait(done);
+
+  _running.store(false, std::memory_order_release);
+}
+
+void WorkerPool::workerLoop()
+{
+  while (true)
+  {
+    // The quit flag is set before the state changes, so it has to be checked after loading the
+    // state. Otherwise, the worker could miss the flag and then wait on the changed state forever:
+    const auto state = _state.load(std::memory_order_acquire);
+    if (_quit)
+      return;
+
+    if (!runAvailableTasks())
+      _state.wait(state);
+  }
+}
+
+auto WorkerPool::runAvailableTasks() -> bool
+{
+  auto ranAnyTasks = false;
+  auto state = _state.load(std::memory_order_acquire);
+
+  while (nextTaskOf(state) < numTasksOf(state))
+  {
+    // Claiming only succeeds if the state hasn't changed in the meantime, i.e. if the task still
+    // belongs to the current job:
+    if (!_state.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel))
+      continue;
+
+    _function(_context, nextTaskOf(state));
+    ranAnyTasks = true;
+
+    const auto numTasks = numTasksOf(state);
+    if (_numTasksDone.fetch_add(1) + 1 == numTasks)
+      _numTasksDone.notify_all();
+
+    state = _state.load(std::memory_order_acquire);
+  }
+
+  return ranAnyTasks;
+}
@@ -0,0 +1,115 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace fsh::util
+{
+/**
+A fixed set of worker threads that can split a job into tasks and run them in parallel.
+
+The threads are started in the constructor and stopped in the destructor, so creating a pool is
+expensive and should not be done on the audio thread. Running a job, on the other hand, doesn't
+allocate or lock, and is safe to do from the audio thread:
+
+```cpp
+const auto pool = fsh::util::WorkerPool::shared();
+
+// Calls the lambda once for each index from 0 to 15, spread over the pool and the calling thread:
+pool->run(16, [&](size_t task) { processChannel(task); });
+```
+
+The calling thread works on the tasks too, and run() only returns once all tasks are finished. The
+workers are real-time threads where the system allows it, so the calling thread isn't kept waiting
+on a thread that was preempted. A pool with 0 threads is valid, and simply runs all tasks on the
+calling thread.
+
+Most code should use the pool returned by shared(), so that several plugin instances don't each
+start a full set of threads. The shared pool is stopped when its last user releases it, e.g. when
+the last plugin instance is destroyed, rather than when the process exits. If run() is called while
+another thread is already running a job on the same pool, the second caller doesn't wait for the
+pool, but runs all of its tasks itself.
+*/
+class WorkerPool
+{
+public:
+  /// Start the given number of worker threads.
+  explicit WorkerPool(size_t numThreads = defaultNumThreads());
+
+  /// Stop all worker threads. This waits for the threads to finish.
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;            ///< Not copyable
+  WorkerPool& operator=(const WorkerPool&) = delete; ///< Not copyable
+
+  /// Call `task(i)` for each `i` from 0 to `numTasks - 1`, spread over the worker threads and the
+  /// calling thread. Returns once all tasks have finished.
+  template<typename Task>
+  void run(size_t numTasks, Task&& task)
+  {
+    using TaskType = std::remove_reference_t<Task>;
+    runErased(
+      numTasks, [](void* context, size_t i) { (*static_cast<TaskType*>(context))(i); }, &task);
+  }
+
+  /// Returns the number of worker threads, not counting the thread calling run().
+  auto numThreads() const -> size_t;
+
+  /// One less than the number of hardware threads, since the calling thread also does work, but no
+  /// more than maxDefaultNumThreads.
+  static auto defaultNumThreads() -> size_t;
+
+  /// The pool shared by all current users in the process, with defaultNumThreads() threads. It is
+  /// started if there are no other users, so this should not be called on the audio thread.
+  static auto shared() -> std::shared_ptr<WorkerPool>;
+
+  /// Upper limit for defaultNumThreads(), so a pool doesn't take over a machine with many cores.
+  static constexpr size_t maxDefaultNumThreads = 4;
+
+private:
+  class Worker;
+  using TaskFunction = void (*)(void* context, size_t task);
+
+  void runErased(size_t numTasks, TaskFunction, void* context);
+  void workerLoop();
+  auto runAvailableTasks() -> bool;
+
+  // The job state is packed into a single atomic word, so the tasks of a job can only be claimed
+  // while that job is current: the generation in the upper 32 bits, the number of tasks in the
+  // middle 16 bits, and the index of the next task to be claimed in the lower 16 bits. The
+  // generation only repeats after 2^32 jobs, so a worker that was preempted while claiming a task
+  // can't mistake a later job for its own.
+  std::atomic<uint64_t> _state = 0;
+  std::atomic<size_t> _numTasksDone = 0;
+  std::atomic<bool> _quit = false;
+  std::atomic<bool> _running = false;
+
+  TaskFunction _function = nullptr;
+  void* _context = nullptr;
+
+  std::vector<std::unique_ptr<Worker>> _threads;
+};
+} // namespace fsh::util
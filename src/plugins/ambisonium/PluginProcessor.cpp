@@ -23,12 +23,26 @@
 #include "PluginEditor.h"
 #include "SphericalHarmonics.h"
 #include "Synth.h"
+#include <algorithm>
+
+namespace
+{
+// How often the reverb thread parameter is checked for changes:
+constexpr auto reverbThreadCheckRateHz = 10;
+} // namespace
 
 PluginProcessor::PluginProcessor()
   : Processor({
       .outputs = juce::AudioChannelSet::ambisonic(fsh::util::maxAmbiOrder),
     })
 {
+  _seed = _params.getSeed();
+  startTimerHz(reverbThreadCheckRateHz);
+}
+
+PluginProcessor::~PluginProcessor()
+{
+  stopTimer();
 }
 
 auto PluginProcessor::customEditor() -> std::unique_ptr<juce::AudioProcessorEditor>
@@ -36,24 +50,90 @@ auto PluginProcessor::customEditor() -> std::unique_ptr<juce::AudioProcessorEdit
   return std::make_unique<PluginEditor>(*this, _params);
 }
 
+bool PluginProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+  const auto numChannels = layouts.getMainOutputChannelSet().size();
+  const auto order = fsh::util::orderForNumChannels(numChannels);
+  return layouts.getMainInputChannelSet().isDisabled() && order >= 1 &&
+         order <= fsh::util::maxAmbiOrder;
+}
+
 void PluginProcessor::prepareToPlay(double sampleRate, int bufferSize)
 {
-  juce::ignoreUnused(bufferSize);
-  _synth.reset();
-  _synth.setSampleRate(sampleRate);
-  _reverb.setSampleRate(sampleRate);
-  _reverb.reset();
+  // The worker thread uses the reverb, so it's stopped before the reverb is replaced:
+  _reverbWorker.release();
+
+  // Only render as many ambisonic channels as the output bus has:
+  const auto order = fsh::util::orderForNumChannels(getTotalNumOutputChannels());
+  fsh::util::emplaceOrder(_synth, order);
+  _synthSeed = _seed;
+  std::visit(
+    [&](auto& synth)
+    {
+      synth.setSeed(_synthSeed);
+      synth.reset();
+      synth.setSampleRate(sampleRate);
+    },
+    _synth);
+
+  // The reverb has fewer delay lines at lower orders, see fsh::fx::fdnSizeForOrder():
+  fsh::util::emplaceOrder<fsh::fx::OrderReverb>(_reverb, order);
+  std::visit(
+    [&](auto& reverb)
+    {
+      reverb.setSampleRate(sampleRate);
+      reverb.reset();
+    },
+    _reverb);
+
+  // The reverb can run on a worker thread, in parallel with the synth rendering the next block, at
+  // the cost of one block of latency. This is only switched here, so the latency never changes
+  // during playback, see timerCallback():
+  _reverbOnWorkerThread = _params.getReverbOnWorkerThread();
+  _workerLatencySamples = std::max(bufferSize, 1);
+  if (_reverbOnWorkerThread)
+    _reverbWorker.prepare(getTotalNumOutputChannels(),
+                          bufferSize,
+                          sampleRate,
+                          [this](juce::AudioBuffer<float>& block) { processReverb(block); });
+  setLatencySamples(_reverbOnWorkerThread ? _workerLatencySamples.load() : 0);
+}
+
+void PluginProcessor::timerCallback()
+{
+  // When the reverb thread parameter changes, the latency it will have is reported right away.
+  // Hosts respond to a latency change by preparing the plugin again, which switches the thread:
+  const auto onWorkerThread = _params.getReverbOnWorkerThread();
+  if (onWorkerThread != _reverbOnWorkerThread)
+    setLatencySamples(onWorkerThread ? _workerLatencySamples.load() : 0);
+}
+
+void PluginProcessor::releaseResources()
+{
+  _reverbWorker.release();
 }
 
 void PluginProcessor::processBlock(juce::AudioBuffer<float>& audio, juce::MidiBuffer& midi)
 {
   audio.clear();
 
-  _synth.setParams(_params.getSynthParams());
-  _synth.process(audio, midi);
+  std::visit(
+    [&](auto& synth)
+    {
+      if (const auto seed = _seed.load(); seed != _synthSeed)
+      {
+        _synthSeed = seed;
+        synth.setSeed(seed);
+      }
+      synth.setParams(_params.getSynthParams());
+      synth.process(audio, midi);
+    },
+    _synth);
 
-  _reverb.setPreset(_params.getReverbPreset());
-  _reverb.process(audio);
+  if (_reverbOnWorkerThread)
+    _reverbWorker.process(audio);
+  else
+    processReverb(audio);
 
   _bufferProtector.setParams({
     .maxDb = +12.0f,
@@ -62,6 +142,18 @@ void PluginProcessor::processBlock(juce::AudioBuffer<float>& audio, juce::MidiBu
   _bufferProtector.process(audio);
 }
 
+void PluginProcessor::processReverb(juce::AudioBuffer<float>& audio)
+{
+  std::visit(
+    [&](auto& reverb)
+    {
+      reverb.setPreset(_params.getReverbPreset());
+      reverb.process(audio);
+      setTailLengthSeconds(reverb.getTailLengthSeconds());
+    },
+    _reverb);
+}
+
 void PluginProcessor::processBlock(juce::AudioBuffer<double>& audio, juce::MidiBuffer& midi)
 {
   juce::ignoreUnused(midi);
@@ -69,7 +161,14 @@ void PluginProcessor::processBlock(juce::AudioBuffer<double>& audio, juce::MidiB
   spdlog::critical("double precision not supported");
 }
 
+void PluginProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+  // A recalled state brings its own seed, which the synth picks up on the next block:
+  Processor::setStateInformation(data, sizeInBytes);
+  _seed = _params.getSeed();
+}
+
 void PluginProcessor::allNotesOff()
 {
-  _synth.reset();
+  std::visit([](auto& synth) { synth.reset(); }, _synth);
 }
@@ -20,26 +20,45 @@
 ***************************************************************************************************/
 
 #pragma once
+#include "AsyncBlockProcessor.h"
 #include "BufferProtector.h"
 #include "FDNReverb.h"
+#include "OrderVariant.h"
 #include "PluginState.h"
 #include "Processor.h"
 #include "Synth.h"
+#include <atomic>
 
-class PluginProcessor : public fsh::plugin::Processor<PluginState>
+class PluginProcessor
+  : public fsh::plugin::Processor<PluginState>
+  , private juce::Timer
 {
 public:
   PluginProcessor();
+  ~PluginProcessor() override;
   auto customEditor() -> std::unique_ptr<juce::AudioProcessorEditor> override;
 
+  bool isBusesLayoutSupported(const BusesLayout&) const override;
   void prepareToPlay(double sampleRate, int bufferSize) override;
+  void releaseResources() override;
   void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
   void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+  void setStateInformation(const void* data, int sizeInBytes) override;
 
   void allNotesOff();
 
 private:
-  fsh::synth::Synth _synth;
-  fsh::fx::FDNReverb _reverb;
+  void timerCallback() override;
+  void processReverb(juce::AudioBuffer<float>&);
+
+  fsh::util::OrderVariant<fsh::synth::Synth> _synth;
+  fsh::util::OrderVariant<fsh::fx::OrderReverb> _reverb;
+  fsh::util::AsyncBlockProcessor _reverbWorker;
+  std::atomic<bool> _reverbOnWorkerThread = false;
+  std::atomic<int> _workerLatencySamples = 0;
   fsh::util::BufferProtector _bufferProtector;
+
+  // The noise seed saved with the plugin state, and the one the synth currently uses:
+  std::atomic<uint32_t> _seed = 0;
+  uint32_t _synthSeed = 0;
 };
@@ -225,6 +225,12 @@ auto createParameterLayout() -> juce::AudioProcessorValueTreeState::ParameterLay
       .choices = { "Off", "Earth", "Metal", "Sky" },
     }
       .create(),
+    ParamChoice{
+      .id = id(reverb_thread),
+      .name = "REVERB: thread",
+      .choices = { "Audio", "Worker" },
+    }
+      .create(),
     ParamFloat{
       .id = id(voice_glide),
       .name = "VOICE: glide",
@@ -250,7 +256,7 @@ PluginState::PluginState(juce::AudioProcessor& parent)
   juce::ignoreUnused(id(voice_polyphony)); // TODO
 }
 
-auto PluginState::getSynthParams() const -> fsh::synth::Synth::Params
+auto PluginState::getSynthParams() const -> fsh::synth::SynthParams
 {
   const auto detune = [](float semi, float cents)
   {
@@ -296,9 +302,28 @@ auto PluginState::getSynthParams() const -> fsh::synth::Synth::Params
   };
 }
 
-auto PluginState::getReverbPreset() const -> fsh::fx::FDNReverb::Preset
+auto PluginState::getReverbPreset() const -> fsh::fx::ReverbPreset
+{
+  return getParameter<fsh::fx::ReverbPreset>(id(reverb));
+}
+
+auto PluginState::getReverbOnWorkerThread() const -> bool
 {
-  return getParameter<fsh::fx::FDNReverb::Preset>(id(reverb));
+  // This is a choice rather than a bool parameter, so it reads as "Audio"/"Worker" in the host:
+  return getParameter<int>(id(reverb_thread)) == 1;
+}
+
+auto PluginState::getSeed() -> uint32_t
+{
+  // The seed is picked at random the first time, and then saved with the state, so each instance
+  // plays different noise, but a session always renders the same noise when it is reloaded:
+  const auto seedID = juce::Identifier{ "seed" };
+  if (const auto seed = getStateProperty(seedID); !seed.isVoid())
+    return static_cast<uint32_t>(static_cast<juce::int64>(seed));
+
+  const auto seed = static_cast<uint32_t>(juce::Random::getSystemRandom().nextInt());
+  setStateProperty(seedID, static_cast<juce::int64>(seed));
+  return seed;
 }
 
 auto PluginState::getID(Param p) -> juce::ParameterID
@@ -349,6 +374,8 @@ auto PluginState::getID(Param p) -> juce::ParameterID
       return "oscB_waveform";
     case reverb:
       return "reverb";
+    case reverb_thread:
+      return "reverb_thread";
     case voice_glide:
       return "voice_glide";
     case voice_polyphony:
@@ -59,13 +59,16 @@ public:
     oscB_waveform,
 
     reverb,
+    reverb_thread,
 
     voice_glide,
     voice_polyphony,
   };
 
   explicit PluginState(juce::AudioProcessor&);
-  auto getSynthParams() const -> fsh::synth::Synth::Params;
-  auto getReverbPreset() const -> fsh::fx::FDNReverb::Preset;
+  auto getSynthParams() const -> fsh::synth::SynthParams;
+  auto getReverbPreset() const -> fsh::fx::ReverbPreset;
+  auto getReverbOnWorkerThread() const -> bool;
+  auto getSeed() -> uint32_t;
   static auto getID(Param) -> juce::ParameterID;
 };
@@ -0,0 +1,110 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "PluginProcessor.h"
+#include <spdlog/spdlog.h>
+
+namespace
+{
+// How often the layout parameters are checked for changes:
+constexpr auto layoutUpdateRateHz = 10;
+} // namespace
+
+PluginProcessor::PluginProcessor()
+  : Processor({
+      .outputs = juce::AudioChannelSet::discreteChannels(PluginState::defaultNumOutputs),
+      .inputs = juce::AudioChannelSet::ambisonic(fsh::util::maxAmbiOrder),
+    })
+{
+  updateLayout();
+  startTimerHz(layoutUpdateRateHz);
+}
+
+PluginProcessor::~PluginProcessor()
+{
+  stopTimer();
+}
+
+bool PluginProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+  using Decoder = fsh::fx::AmbisonicDecoder<>;
+  const auto order = fsh::util::orderForNumChannels(layouts.getMainInputChannelSet().size());
+  const auto numOutputs = layouts.getMainOutputChannelSet().size();
+  return order >= 1 && order <= fsh::util::maxAmbiOrder && numOutputs >= 1 &&
+         numOutputs <= Decoder::maxNumSpeakers;
+}
+
+void PluginProcessor::prepareToPlay(double sampleRate, int maxBlockSize)
+{
+  juce::ignoreUnused(sampleRate);
+
+  // Decode as many ambisonic channels as the input bus has. The new decoder needs its matrix to be
+  // computed again, so it's silent for the first few milliseconds:
+  const auto order = fsh::util::orderForNumChannels(getTotalNumInputChannels());
+  fsh::util::emplaceOrder(_decoder, order);
+  updateLayout();
+
+  _input.setSize(getTotalNumInputChannels(), maxBlockSize);
+}
+
+void PluginProcessor::timerCallback()
+{
+  const auto params = _params.decoderParams();
+  if (_params.layoutIndex() != _layoutIndex || params.method != _decoderParams.method ||
+      params.maxRE != _decoderParams.maxRE)
+    updateLayout();
+}
+
+void PluginProcessor::updateLayout()
+{
+  // This waits for any previous matrix computation to finish, so it must not be called on the
+  // audio thread:
+  _layoutIndex = _params.layoutIndex();
+  _decoderParams = _params.decoderParams();
+
+  const auto layout = PluginState::speakerLayout(_layoutIndex);
+  std::visit([&](auto& decoder) { decoder.setLayout(layout, _decoderParams); }, _decoder);
+}
+
+void PluginProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+  const auto bufferSize = buffer.getNumSamples();
+  const auto numInputs = getTotalNumInputChannels();
+
+  // The ambisonic inputs share their channels with the speaker outputs, so they need to be copied
+  // before the outputs are overwritten. This only reallocates if the host exceeds maxBlockSize:
+  _input.setSize(numInputs, bufferSize, false, false, true);
+  for (auto ch = 0; ch < numInputs; ++ch)
+    _input.copyFrom(ch, 0, buffer, ch, 0, bufferSize);
+
+  // Any speakers beyond the layout, and any channels beyond the output bus, are cleared:
+  std::visit([&](auto& decoder) { decoder.process(_input, buffer); }, _decoder);
+
+  const auto gain = juce::Decibels::decibelsToGain(_params.gain());
+  buffer.applyGain(gain);
+}
+
+void PluginProcessor::processBlock(juce::AudioBuffer<double>& audio, juce::MidiBuffer& midi)
+{
+  juce::ignoreUnused(midi);
+  audio.clear();
+  spdlog::critical("double precision not supported");
+}
@@ -0,0 +1,51 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "AmbisonicDecoder.h"
+#include "OrderVariant.h"
+#include "PluginState.h"
+#include "Processor.h"
+
+class PluginProcessor
+  : public fsh::plugin::Processor<PluginState>
+  , private juce::Timer
+{
+public:
+  PluginProcessor();
+  ~PluginProcessor() override;
+
+  bool isBusesLayoutSupported(const BusesLayout&) const override;
+  void prepareToPlay(double sampleRate, int maxBlockSize) override;
+  void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+  void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+private:
+  void timerCallback() override;
+  void updateLayout();
+
+  fsh::util::OrderVariant<fsh::fx::AmbisonicDecoder> _decoder;
+  juce::AudioBuffer<float> _input;
+
+  // The layout parameters that the current decoding matrix was computed for:
+  int _layoutIndex = -1;
+  fsh::fx::DecoderParams _decoderParams;
+};
@@ -0,0 +1,119 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "PluginState.h"
+#include "ParamChoice.h"
+#include "ParamFloat.h"
+#include <algorithm>
+#include <array>
+#include <fmt/format.h>
+
+namespace
+{
+struct Preset
+{
+  const char* name;
+  const char* layout; // in the plain text format of util::SpeakerLayout
+};
+
+// The speakers are listed in the usual channel order for each format:
+const auto presets = std::array{
+  Preset{ "Stereo", "-30 0\n30 0\n" },
+  Preset{ "Quad", "-45 0\n45 0\n-135 0\n135 0\n" },
+  Preset{ "5.0", "-30 0\n30 0\n0 0\n-110 0\n110 0\n" },
+  Preset{ "Octagon", "0 0\n45 0\n90 0\n135 0\n180 0\n-135 0\n-90 0\n-45 0\n" },
+  Preset{ "Cube",
+          "-45 35.26\n45 35.26\n-135 35.26\n135 35.26\n"
+          "-45 -35.26\n45 -35.26\n-135 -35.26\n135 -35.26\n" },
+  Preset{ "7.0.4",
+          "-30 0\n30 0\n0 0\n-90 0\n90 0\n-135 0\n135 0\n"
+          "-45 45\n45 45\n-135 45\n135 45\n" },
+};
+
+juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
+{
+  const auto decibelsLabel = fsh::plugin::ParamFloat::Attributes{}.withStringFromValueFunction(
+    [](float val, int) { return fmt::format("{:+.1f} dB", val); });
+
+  auto layoutNames = juce::StringArray{};
+  for (const auto& preset : presets)
+    layoutNames.add(preset.name);
+
+  return {
+    fsh::plugin::ParamChoice{
+      .id = "layout",
+      .name = "Speaker Layout",
+      .choices = layoutNames,
+    }
+      .create(),
+    fsh::plugin::ParamChoice{
+      .id = "method",
+      .name = "Decoding Method",
+      .choices = { "AllRAD", "SAD" },
+    }
+      .create(),
+    fsh::plugin::ParamChoice{
+      .id = "weighting",
+      .name = "Order Weighting",
+      .choices = { "max-rE", "Basic" },
+    }
+      .create(),
+    fsh::plugin::ParamFloat{
+      .id = "gain",
+      .name = "Gain",
+      .range = { -12.0f, +12.0f },
+      .defaultVal = 0.0f,
+      .attributes = decibelsLabel,
+    }
+      .create(),
+  };
+}
+} // namespace
+
+PluginState::PluginState(juce::AudioProcessor& parent)
+  : StateManager(parent, createParameterLayout())
+{
+}
+
+auto PluginState::layoutIndex() const -> int
+{
+  return getParameter<int>("layout");
+}
+
+auto PluginState::decoderParams() const -> fsh::fx::DecoderParams
+{
+  return {
+    .method = getParameter<fsh::fx::DecodingMethod>("method"),
+    .maxRE = getParameter<int>("weighting") == 0,
+  };
+}
+
+auto PluginState::gain() const -> float
+{
+  return getParameter<float>("gain");
+}
+
+auto PluginState::speakerLayout(int index) -> fsh::util::SpeakerLayout
+{
+  const auto lastIndex = static_cast<int>(presets.size()) - 1;
+  const auto preset = presets[static_cast<size_t>(std::clamp(index, 0, lastIndex))];
+  return fsh::util::SpeakerLayout::fromString(preset.layout).value_or(fsh::util::SpeakerLayout{});
+}
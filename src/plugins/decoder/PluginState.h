@@ -0,0 +1,41 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "AmbisonicDecoder.h"
+#include "SpeakerLayout.h"
+#include "StateManager.h"
+
+class PluginState : public fsh::plugin::StateManager
+{
+public:
+  /// Number of output channels, unless the host asks for a different number.
+  static constexpr auto defaultNumOutputs = 16;
+
+  explicit PluginState(juce::AudioProcessor&);
+
+  auto layoutIndex() const -> int;
+  auto decoderParams() const -> fsh::fx::DecoderParams;
+  auto gain() const -> float;
+
+  /// The speaker layout with the given index, as listed in the layout parameter.
+  static auto speakerLayout(int index) -> fsh::util::SpeakerLayout;
+};
@@ -22,6 +22,7 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "SphericalHarmonics.h"
+#include <algorithm>
 #include <juce_dsp/juce_dsp.h>
 #include <spdlog/spdlog.h>
 
@@ -33,12 +34,28 @@ PluginProcessor::PluginProcessor()
 {
 }
 
+bool PluginProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+  const auto numChannels = layouts.getMainOutputChannelSet().size();
+  const auto order = fsh::util::orderForNumChannels(numChannels);
+  return layouts.getMainInputChannelSet() == juce::AudioChannelSet::stereo() && order >= 1 &&
+         order <= fsh::util::maxAmbiOrder;
+}
+
 void PluginProcessor::prepareToPlay(double sampleRate, int maxBlockSize)
 {
-  juce::ignoreUnused(maxBlockSize);
+  // Only encode as many ambisonic channels as the output bus has:
+  const auto order = fsh::util::orderForNumChannels(getTotalNumOutputChannels());
+  fsh::util::emplaceOrder(_encoders, order);
+  std::visit(
+    [&](auto& encoders)
+    {
+      encoders.left.setSampleRate(sampleRate);
+      encoders.right.setSampleRate(sampleRate);
+    },
+    _encoders);
 
-  _leftEncoder.setSampleRate(sampleRate);
-  _rightEncoder.setSampleRate(sampleRate);
+  _input.setSize(2, maxBlockSize);
 
   _gain.prepare({
     .sampleRate = sampleRate,
@@ -49,29 +66,38 @@ void PluginProcessor::prepareToPlay(double sampleRate, int maxBlockSize)
 
 void PluginProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
 {
-  _leftEncoder.setParams({ .direction = _params.vectorLeft(), .order = _params.ambiOrder() });
-  _rightEncoder.setParams({ .direction = _params.vectorRight(), .order = _params.ambiOrder() });
-
   const auto bufferSize = buffer.getNumSamples();
-  const auto numChannels = static_cast<size_t>(buffer.getNumChannels());
-
-  for (auto i = 0; i < bufferSize; ++i)
-  {
-    const auto leftInputSample = buffer.getSample(0, i);
-    const auto rightInputSample = buffer.getSample(1, i);
-
-    const auto leftCoeffs = _leftEncoder.getCoefficientsForNextSample();
-    const auto rightCoeffs = _rightEncoder.getCoefficientsForNextSample();
 
-    const auto channelsToProcess = juce::jmin(numChannels, leftCoeffs.size(), rightCoeffs.size());
+  // The stereo input shares its channels with the ambisonic output, so it needs to be copied
+  // before the output channels are overwritten. This only reallocates if the host exceeds
+  // maxBlockSize:
+  _input.setSize(2, bufferSize, false, false, true);
+  _input.copyFrom(0, 0, buffer, 0, 0, bufferSize);
+  _input.copyFrom(1, 0, buffer, 1, 0, bufferSize);
 
-    for (auto ch = 0U; ch < channelsToProcess; ++ch)
+  std::visit(
+    [&](auto& encoders)
     {
-      const auto leftOutputSample = leftInputSample * leftCoeffs[ch];
-      const auto rightOutputSample = rightInputSample * rightCoeffs[ch];
-      buffer.setSample(static_cast<int>(ch), i, leftOutputSample + rightOutputSample);
-    }
-  }
+      // The order parameter can be higher than the order of the output bus:
+      constexpr auto maxOrder = static_cast<float>(decltype(encoders.left)::maxOrder);
+      const auto order = std::min(_params.ambiOrder(), maxOrder);
+
+      using Smoothing = typename decltype(encoders.left)::Smoothing;
+      encoders.left.setParams({
+        .direction = _params.vectorLeft(),
+        .order = order,
+        .smoothing = Smoothing::Linear,
+      });
+      encoders.right.setParams({
+        .direction = _params.vectorRight(),
+        .order = order,
+        .smoothing = Smoothing::Linear,
+      });
+
+      encoders.left.encodeBlock(_input.getReadPointer(0), buffer, bufferSize, false);
+      encoders.right.encodeBlock(_input.getReadPointer(1), buffer, bufferSize, true);
+    },
+    _encoders);
 
   auto block = juce::dsp::AudioBlock<float>{ buffer };
   auto context = juce::dsp::ProcessContextReplacing<float>{ block };
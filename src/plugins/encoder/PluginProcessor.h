@@ -21,22 +21,32 @@
 
 #pragma once
 #include "AmbisonicEncoder.h"
+#include "OrderVariant.h"
 #include "PluginState.h"
 #include "Processor.h"
 #include <juce_dsp/juce_dsp.h>
 
+/// Encoders for the left and right input channels, for a given ambisonic order.
+template<int Order>
+struct StereoEncoder
+{
+  fsh::fx::AmbisonicEncoder<Order> left;
+  fsh::fx::AmbisonicEncoder<Order> right;
+};
+
 class PluginProcessor : public fsh::plugin::Processor<PluginState>
 {
 public:
   PluginProcessor();
   auto customEditor() -> std::unique_ptr<juce::AudioProcessorEditor> override;
 
+  bool isBusesLayoutSupported(const BusesLayout&) const override;
   void prepareToPlay(double sampleRate, int maxBlockSize) override;
   void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
   void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
 
 private:
-  fsh::fx::AmbisonicEncoder _leftEncoder;
-  fsh::fx::AmbisonicEncoder _rightEncoder;
+  fsh::util::OrderVariant<StereoEncoder> _encoders;
+  juce::AudioBuffer<float> _input;
   juce::dsp::Gain<float> _gain;
 };
@@ -0,0 +1,92 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "PluginProcessor.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <type_traits>
+
+PluginProcessor::PluginProcessor()
+  : Processor({
+      .outputs = juce::AudioChannelSet::ambisonic(fsh::util::maxAmbiOrder),
+      .inputs = juce::AudioChannelSet::discreteChannels(PluginState::numSources),
+    })
+{
+}
+
+bool PluginProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+  const auto numInputs = layouts.getMainInputChannelSet().size();
+  const auto order = fsh::util::orderForNumChannels(layouts.getMainOutputChannelSet().size());
+  return numInputs >= 1 && numInputs <= PluginState::numSources && order >= 1 &&
+         order <= fsh::util::maxAmbiOrder;
+}
+
+void PluginProcessor::prepareToPlay(double sampleRate, int maxBlockSize)
+{
+  juce::ignoreUnused(sampleRate);
+
+  // Only encode as many ambisonic channels as the output bus has. (This restarts the encoder's
+  // worker threads, which is fine here, since prepareToPlay() is not called on the audio thread.)
+  const auto order = fsh::util::orderForNumChannels(getTotalNumOutputChannels());
+  fsh::util::emplaceOrder(_encoder, order);
+
+  _input.setSize(getTotalNumInputChannels(), maxBlockSize);
+}
+
+void PluginProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+  const auto bufferSize = buffer.getNumSamples();
+  const auto numInputs = getTotalNumInputChannels();
+
+  // The inputs share their channels with the ambisonic outputs, so they need to be copied before
+  // the output channels are overwritten. This only reallocates if the host exceeds maxBlockSize:
+  _input.setSize(numInputs, bufferSize, false, false, true);
+  for (auto ch = 0; ch < numInputs; ++ch)
+    _input.copyFrom(ch, 0, buffer, ch, 0, bufferSize);
+
+  const auto gain = juce::Decibels::decibelsToGain(_params.gain());
+
+  std::visit(
+    [&](auto& encoder)
+    {
+      // The order parameter can be higher than the order of the output bus:
+      constexpr auto maxOrder = static_cast<float>(std::decay_t<decltype(encoder)>::maxOrder);
+      encoder.setParams({ .order = std::min(_params.ambiOrder(), maxOrder) });
+
+      for (auto source = 0UL; source < static_cast<size_t>(numInputs); ++source)
+        encoder.setSourceParams(source, { .direction = _params.direction(source), .gain = gain });
+
+      encoder.process(_input, buffer);
+    },
+    _encoder);
+
+  // Any channels beyond the ambisonic output are left over from the inputs:
+  for (auto ch = getTotalNumOutputChannels(); ch < buffer.getNumChannels(); ++ch)
+    buffer.clear(ch, 0, bufferSize);
+}
+
+void PluginProcessor::processBlock(juce::AudioBuffer<double>& audio, juce::MidiBuffer& midi)
+{
+  juce::ignoreUnused(midi);
+  audio.clear();
+  spdlog::critical("double precision not supported");
+}
@@ -0,0 +1,41 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "MultiSourceEncoder.h"
+#include "OrderVariant.h"
+#include "PluginState.h"
+#include "Processor.h"
+
+class PluginProcessor : public fsh::plugin::Processor<PluginState>
+{
+public:
+  PluginProcessor();
+
+  bool isBusesLayoutSupported(const BusesLayout&) const override;
+  void prepareToPlay(double sampleRate, int maxBlockSize) override;
+  void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+  void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+private:
+  fsh::util::OrderVariant<fsh::fx::MultiSourceEncoder> _encoder;
+  juce::AudioBuffer<float> _input;
+};
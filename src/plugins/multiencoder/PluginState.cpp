@@ -0,0 +1,122 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#include "PluginState.h"
+#include "ParamFloat.h"
+#include "SphericalHarmonics.h"
+#include <fmt/format.h>
+
+namespace
+{
+auto azimuthID(size_t source) -> juce::ParameterID
+{
+  return fmt::format("azimuth {}", source + 1);
+}
+
+auto elevationID(size_t source) -> juce::ParameterID
+{
+  return fmt::format("elevation {}", source + 1);
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
+{
+  const auto degreesLabel = fsh::plugin::ParamFloat::Attributes{}.withStringFromValueFunction(
+    [](float val, int) { return fmt::format("{:+.1f}°", val); });
+
+  const auto decibelsLabel = fsh::plugin::ParamFloat::Attributes{}.withStringFromValueFunction(
+    [](float val, int) { return fmt::format("{:+.1f} dB", val); });
+
+  auto layout = juce::AudioProcessorValueTreeState::ParameterLayout{
+    fsh::plugin::ParamFloat{
+      .id = "order",
+      .name = "Spatial Resolution",
+      .range = { 0.0f, fsh::util::maxAmbiOrder },
+      .defaultVal = fsh::util::maxAmbiOrder,
+    }
+      .create(),
+    fsh::plugin::ParamFloat{
+      .id = "gain",
+      .name = "Gain",
+      .range = { -12.0f, +12.0f },
+      .defaultVal = 0.0f,
+      .attributes = decibelsLabel,
+    }
+      .create(),
+  };
+
+  for (auto source = 0UL; source < PluginState::numSources; ++source)
+  {
+    const auto azimuth = fsh::plugin::ParamFloat{
+      .id = azimuthID(source),
+      .name = fmt::format("Azimuth ({})", source + 1),
+      .range = { -180.0f, 180.0f },
+      .defaultVal = 0.0f,
+      .attributes = degreesLabel,
+    };
+    const auto elevation = fsh::plugin::ParamFloat{
+      .id = elevationID(source),
+      .name = fmt::format("Elevation ({})", source + 1),
+      .range = { -90.0f, 90.0f },
+      .defaultVal = 0.0f,
+      .attributes = degreesLabel,
+    };
+    layout.add(azimuth.create());
+    layout.add(elevation.create());
+  }
+
+  return layout;
+}
+} // namespace
+
+PluginState::PluginState(juce::AudioProcessor& parent)
+  : StateManager(parent, createParameterLayout())
+{
+  // The IDs are created once here, so they don't need to be formatted on the audio thread:
+  for (auto source = 0UL; source < numSources; ++source)
+  {
+    _azimuthIDs.push_back(azimuthID(source));
+    _elevationIDs.push_back(elevationID(source));
+  }
+}
+
+auto PluginState::ambiOrder() const -> float
+{
+  return getParameter<float>("order");
+}
+
+auto PluginState::gain() const -> float
+{
+  return getParameter<float>("gain");
+}
+
+auto PluginState::direction(size_t source) const -> fsh::util::SphericalVector
+{
+  if (source >= numSources)
+  {
+    spdlog::error("PluginState: source {} out of range ({} sources)", source, numSources);
+    return {};
+  }
+
+  return {
+    .azimuth = getParameter<float>(_azimuthIDs[source]),
+    .elevation = getParameter<float>(_elevationIDs[source]),
+  };
+}
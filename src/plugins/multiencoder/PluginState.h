@@ -0,0 +1,42 @@
+/***************************************************************************************************
+                 ██████          █████                              █████    █████
+                ███░░███        ░░███                              ░░███    ░░███
+               ░███ ░░░   █████  ░███████      ██    ██     █████  ███████   ░███ █████
+              ███████    ███░░   ░███░░███    ░░    ░░     ███░░  ░░░███░    ░███░░███
+             ░░░███░    ░░█████  ░███ ░███                ░░█████   ░███     ░██████░
+               ░███      ░░░░███ ░███ ░███                 ░░░░███  ░███ ███ ░███░░███
+               █████     ██████  ████ █████    ██    ██    ██████   ░░█████  ████ █████
+             ░░░░░     ░░░░░░  ░░░░ ░░░░░    ░░    ░░    ░░░░░░     ░░░░░  ░░░░ ░░░░░
+
+            fantastic  spatial  holophonic               synthesis    tool    kit
+
+                                    copyright (c) fabian hummel
+                                       www.github.com/fshstk
+                                           www.fshstk.com
+
+         this file is part of the fantastic spatial holophonic synthesis toolkit (fsh::stk)
+  fsh::stk is free software: it is provided under the terms of the gnu general public license v3.0
+                                    www.gnu.org/licenses/gpl-3.0
+***************************************************************************************************/
+
+#pragma once
+#include "SphericalVector.h"
+#include "StateManager.h"
+#include <vector>
+
+class PluginState : public fsh::plugin::StateManager
+{
+public:
+  /// Number of sources, i.e. the maximum number of input channels.
+  static constexpr auto numSources = 64;
+
+  explicit PluginState(juce::AudioProcessor&);
+
+  auto ambiOrder() const -> float;
+  auto gain() const -> float;
+  auto direction(size_t source) const -> fsh::util::SphericalVector;
+
+private:
+  std::vector<juce::ParameterID> _azimuthIDs;
+  std::vector<juce::ParameterID> _elevationIDs;
+};